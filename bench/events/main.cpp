@@ -0,0 +1,226 @@
+// Cross-thread event posting: contention benchmark and consistency check for EventDispatcher::PostAsync.
+//   kingdom-event-bench               throughput at 1, 2, 4 .. N producer threads, against a mutex guarded vector
+//   kingdom-event-bench --check 50    exits with 1 when an event is lost, duplicated or reordered; build with
+//                                     -DCMAKE_CXX_FLAGS=-fsanitize=thread to have TSan watch the queue
+#include "core/event.h"
+#include "core/job_system.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+  struct CounterEvent {
+    static constexpr const char* name = "Counter";
+    static constexpr uint8_t signature = EVENT_OTHER;
+    static constexpr bool coalesce = false;
+
+    int producer;
+    uint32_t sequence;
+  };
+
+  struct ProgressEvent {
+    static constexpr const char* name = "Progress";
+    static constexpr uint8_t signature = EVENT_OTHER;
+    static constexpr bool coalesce = true;
+
+    int producer;
+    uint32_t sequence;
+  };
+
+  struct Options {
+    std::vector<int> producerCounts;
+    int eventsPerProducer = 200000;
+    int checkRounds = 0;
+  };
+
+  // Main thread side, checks that every producer's events arrive once and in order
+  struct Receiver {
+    std::vector<uint32_t> nextSequence;
+    std::vector<uint32_t> lastProgress;
+    uint64_t received = 0;
+    uint64_t errors = 0;
+
+    explicit Receiver(int producers) : nextSequence(size_t(producers), 0), lastProgress(size_t(producers), 0) { }
+
+    void OnCounter(const CounterEvent& event) {
+      errors += event.sequence != nextSequence[event.producer];
+      nextSequence[event.producer] = event.sequence + 1;
+      received++;
+    }
+
+    void OnProgress(const ProgressEvent& event) {
+      // Coalesced, so sequences may skip but never go back
+      errors += event.sequence < lastProgress[event.producer];
+      lastProgress[event.producer] = event.sequence;
+    }
+  };
+
+  struct Run {
+    double ms;
+    uint64_t received;
+    uint64_t errors;
+    uint64_t fullRetries;
+  };
+
+  // Producers post through PostAsync and retry while the queue is full, the calling thread flushes until all
+  // events have arrived
+  Run runAsync(int producers, int eventsPerProducer, bool withProgress) {
+    EventDispatcher dispatcher;
+    Receiver receiver(producers);
+    dispatcher.Subscribe<CounterEvent, &Receiver::OnCounter>(receiver);
+    dispatcher.Subscribe<ProgressEvent, &Receiver::OnProgress>(receiver);
+
+    std::atomic<uint64_t> fullRetries(0);
+    std::atomic<int> finished(0);
+    const uint64_t expected = uint64_t(producers) * uint64_t(eventsPerProducer);
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int producer = 0; producer < producers; producer++) {
+      threads.emplace_back([&, producer]() {
+        uint64_t retries = 0;
+        for (uint32_t sequence = 0; sequence < uint32_t(eventsPerProducer); sequence++) {
+          while (!dispatcher.PostAsync(CounterEvent{ producer, sequence })) {
+            retries++;
+            std::this_thread::yield();
+          }
+          if (withProgress && sequence % 64 == 0) dispatcher.PostAsync(ProgressEvent{ producer, sequence });
+        }
+        fullRetries += retries;
+        finished++;
+      });
+    }
+
+    while (receiver.received < expected) {
+      dispatcher.Flush();
+      if (receiver.received < expected) std::this_thread::yield();
+    }
+    for (auto& thread : threads) thread.join();
+    dispatcher.Flush();
+
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return { ms, receiver.received, receiver.errors + uint64_t(finished.load() != producers), fullRetries.load() };
+  }
+
+  // The same traffic through the obvious locked alternative, for comparison
+  Run runLocked(int producers, int eventsPerProducer) {
+    std::mutex mutex;
+    std::vector<CounterEvent> pending, drained;
+    Receiver receiver(producers);
+    const uint64_t expected = uint64_t(producers) * uint64_t(eventsPerProducer);
+
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (int producer = 0; producer < producers; producer++) {
+      threads.emplace_back([&, producer]() {
+        for (uint32_t sequence = 0; sequence < uint32_t(eventsPerProducer); sequence++) {
+          std::lock_guard<std::mutex> lock(mutex);
+          pending.push_back(CounterEvent{ producer, sequence });
+        }
+      });
+    }
+
+    while (receiver.received < expected) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        drained.swap(pending);
+      }
+      for (const auto& event : drained) receiver.OnCounter(event);
+      drained.clear();
+      if (receiver.received < expected) std::this_thread::yield();
+    }
+    for (auto& thread : threads) thread.join();
+
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return { ms, receiver.received, receiver.errors, 0 };
+  }
+
+  void printUsage() {
+    std::printf(
+        "usage: kingdom-event-bench [options]\n"
+        "  --producers <list>   comma separated producer thread counts (default 1, 2, 4 .. hardware threads)\n"
+        "  --events <n>         events per producer (default 200000)\n"
+        "  --check <rounds>     run the consistency check instead of the benchmark\n");
+  }
+
+  bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+      const std::string arg = argv[i];
+      const bool hasValue = i + 1 < argc;
+
+      if (arg == "--producers" && hasValue) {
+        const std::string list = argv[++i];
+        for (size_t start = 0; start <= list.size();) {
+          const size_t end = std::min(list.find(',', start), list.size());
+          const int producers = std::atoi(list.substr(start, end - start).c_str());
+          if (producers <= 0) return false;
+          options.producerCounts.push_back(producers);
+          start = end + 1;
+        }
+      } else if (arg == "--events" && hasValue) {
+        options.eventsPerProducer = std::max(1, std::atoi(argv[++i]));
+      } else if (arg == "--check" && hasValue) {
+        options.checkRounds = std::max(1, std::atoi(argv[++i]));
+      } else {
+        return false;
+      }
+    }
+
+    if (options.producerCounts.empty()) {
+      const int hardwareThreads = ResolveThreadCount(0);
+      for (int producers = 1; producers < hardwareThreads; producers *= 2) options.producerCounts.push_back(producers);
+      options.producerCounts.push_back(hardwareThreads);
+    }
+    return true;
+  }
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage();
+    return 1;
+  }
+
+  if (options.checkRounds > 0) {
+    // Small runs with more producers than cores and a queue that fills up, to shake out interleavings
+    uint64_t errors = 0;
+    for (const int producers : options.producerCounts) {
+      for (int round = 0; round < options.checkRounds; round++) {
+        const auto run = runAsync(producers, std::min(options.eventsPerProducer, 20000), true);
+        errors += run.errors;
+      }
+      std::printf("%d producers: %d rounds done\n", producers, options.checkRounds);
+    }
+
+    if (errors > 0) {
+      std::printf("%llu event(s) lost, duplicated or out of order\n", (unsigned long long)errors);
+      return 1;
+    }
+    return 0;
+  }
+
+#ifndef NDEBUG
+  std::fprintf(stderr, "warning: assertions are enabled, build with CMAKE_BUILD_TYPE=Release for meaningful numbers\n");
+#endif
+
+  std::printf("%-12s %9s %11s %14s %12s\n", "channel", "producers", "ms", "events/s", "full retries");
+  for (const int producers : options.producerCounts) {
+    const auto async = runAsync(producers, options.eventsPerProducer, false);
+    const auto locked = runLocked(producers, options.eventsPerProducer);
+
+    for (const auto& [name, run] : { std::make_pair("post_async", async), std::make_pair("mutex", locked) }) {
+      std::printf("%-12s %9d %11.3f %14.4g %12llu%s\n", name, producers, run.ms, double(run.received) / (run.ms / 1000.0),
+                  (unsigned long long)run.fullRetries, run.errors ? "  (errors)" : "");
+    }
+    std::fflush(stdout);
+  }
+
+  return 0;
+}
@@ -0,0 +1,251 @@
+// Job system stress test and thread scaling benchmark.
+//   kingdom-job-bench                 parallel-for and nested job workloads at 1, 2, 4 .. N threads
+//   kingdom-job-bench --stress 200    randomized job trees, nested waits and jobs from foreign threads,
+//                                     exits with 1 when a job is lost or runs twice
+#include "core/job_system.h"
+#include "math/perlin.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+  const uint32_t benchSeed = 8008135;
+
+  struct Options {
+    std::vector<int> threadCounts;
+    std::string filter;
+    int stressRounds = 0;
+    double minTime = 0.5; // seconds per workload and thread count
+    int minIterations = 3;
+  };
+
+  // Keeps the optimizer from discarding results
+  std::atomic<uint64_t> sink(0);
+
+  struct Workload {
+    const char* name;
+    std::function<void(JobSystem&)> run;
+  };
+
+  // Spawns a binary tree of jobs on one counter, every node adds its work to visited
+  void spawnTree(JobSystem& jobs, JobCounter& counter, int depth, std::atomic<uint64_t>& visited) {
+    visited.fetch_add(1, std::memory_order_relaxed);
+    if (depth == 0) return;
+
+    jobs.Run(counter, [&jobs, &counter, depth, &visited]() { spawnTree(jobs, counter, depth - 1, visited); });
+    jobs.Run(counter, [&jobs, &counter, depth, &visited]() { spawnTree(jobs, counter, depth - 1, visited); });
+  }
+
+  std::vector<Workload> makeWorkloads() {
+    std::vector<Workload> workloads;
+
+    // Coarse, compute bound rows, the shape of the worldgen passes
+    workloads.push_back({ "noise_rows_2048", [](JobSystem& jobs) {
+      const int size = 2048;
+      Perlin perlin(benchSeed);
+      std::vector<float> out(size_t(size) * size);
+      jobs.ParallelFor(0, size, 8, [&](int firstRow, int lastRow) {
+        for (int y = firstRow; y < lastRow; y++) {
+          for (int x = 0; x < size; x++) {
+            out[size_t(y) * size + x] = perlin.Noise(20.f * float(x) / size, 20.f * float(y) / size, 0.f);
+          }
+        }
+      });
+      sink += uint64_t(out.back() * 1000.f);
+    }});
+
+    // Tiny items, dominated by scheduling overhead
+    workloads.push_back({ "fine_grained_1m", [](JobSystem& jobs) {
+      const int count = 1 << 20;
+      std::vector<uint32_t> out(count);
+      jobs.ParallelFor(0, count, 256, [&](int first, int last) {
+        for (int i = first; i < last; i++) out[i] = uint32_t(i) * 2654435761u;
+      });
+      sink += out[count / 2];
+    }});
+
+    // Many small dependent spawns, like recursive culling or pathfinding
+    workloads.push_back({ "job_tree_2^16", [](JobSystem& jobs) {
+      std::atomic<uint64_t> visited(0);
+      JobCounter counter;
+      spawnTree(jobs, counter, 15, visited);
+      jobs.Wait(counter);
+      sink += visited.load();
+    }});
+
+    return workloads;
+  }
+
+  double medianTime(const Workload& workload, JobSystem& jobs, const Options& options) {
+    using Clock = std::chrono::steady_clock;
+    workload.run(jobs); // warm up
+
+    std::vector<double> samples;
+    double total = 0.0;
+    while (int(samples.size()) < options.minIterations || total < options.minTime * 1000.0) {
+      const auto start = Clock::now();
+      workload.run(jobs);
+      const double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+      samples.push_back(ms);
+      total += ms;
+      if (samples.size() >= 1000) break;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+  }
+
+  // One round of the stress test, returns false when a count is off
+  bool stressRound(JobSystem& jobs, uint32_t seed) {
+    bool passed = true;
+    const auto check = [&passed, seed](const char* what, uint64_t actual, uint64_t expected) {
+      if (actual == expected) return;
+      std::printf("round %u: %s ran %llu times, expected %llu\n", seed, what,
+                  (unsigned long long)actual, (unsigned long long)expected);
+      passed = false;
+    };
+
+    // Trees of random depth, enough of them to wrap the job pools
+    const int depth = 4 + int(seed % 9);
+    std::atomic<uint64_t> visited(0);
+    JobCounter treeCounter;
+    for (int tree = 0; tree < 4; tree++) spawnTree(jobs, treeCounter, depth, visited);
+    jobs.Wait(treeCounter);
+    check("tree nodes", visited.load(), 4 * ((uint64_t(2) << depth) - 1));
+
+    // Every index exactly once, with a grain that doesn't divide the range
+    const int count = 10000 + int(seed * 7919u % 50000);
+    std::vector<std::atomic<uint8_t>> hits(count);
+    for (auto& hit : hits) hit.store(0, std::memory_order_relaxed);
+    jobs.ParallelFor(0, count, 1 + int(seed % 97), [&](int first, int last) {
+      for (int i = first; i < last; i++) hits[i].fetch_add(1, std::memory_order_relaxed);
+    });
+    uint64_t wrongHits = 0;
+    for (auto& hit : hits) wrongHits += hit.load() != 1;
+    check("parallel-for items with a wrong count", wrongHits, 0);
+
+    // Parallel-for inside jobs, the outer jobs wait on the inner ranges
+    std::atomic<uint64_t> nested(0);
+    jobs.ParallelFor(0, 64, 1, [&](int first, int last) {
+      for (int i = first; i < last; i++) {
+        jobs.ParallelFor(0, 100, 7, [&](int a, int b) { nested.fetch_add(uint64_t(b - a), std::memory_order_relaxed); });
+      }
+    });
+    check("nested parallel-for items", nested.load(), 64 * 100);
+
+    // Threads without a deque of their own start and wait on jobs too
+    std::atomic<uint64_t> external(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 3; t++) {
+      threads.emplace_back([&jobs, &external]() {
+        JobCounter counter;
+        for (int i = 0; i < 500; i++) jobs.Run(counter, [&external]() { external.fetch_add(1, std::memory_order_relaxed); });
+        jobs.Wait(counter);
+      });
+    }
+    for (auto& thread : threads) thread.join();
+    check("jobs from foreign threads", external.load(), 3 * 500);
+
+    return passed;
+  }
+
+  void printUsage() {
+    std::printf(
+        "usage: kingdom-job-bench [options]\n"
+        "  --threads <list>     comma separated thread counts (default 1, 2, 4 .. hardware threads)\n"
+        "  --filter <text>      only run workloads whose name contains text\n"
+        "  --min-time <sec>     minimum measured time per workload and thread count (default 0.5)\n"
+        "  --iterations <n>     minimum iterations per workload and thread count (default 3)\n"
+        "  --stress <rounds>    run the stress test instead of the benchmark\n"
+        "  --list               list the workloads and exit\n");
+  }
+
+  bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+      const std::string arg = argv[i];
+      const bool hasValue = i + 1 < argc;
+
+      if (arg == "--threads" && hasValue) {
+        const std::string list = argv[++i];
+        for (size_t start = 0; start <= list.size();) {
+          const size_t end = std::min(list.find(',', start), list.size());
+          const int threads = std::atoi(list.substr(start, end - start).c_str());
+          if (threads <= 0) return false;
+          options.threadCounts.push_back(threads);
+          start = end + 1;
+        }
+      } else if (arg == "--filter" && hasValue) {
+        options.filter = argv[++i];
+      } else if (arg == "--min-time" && hasValue) {
+        options.minTime = std::atof(argv[++i]);
+      } else if (arg == "--iterations" && hasValue) {
+        options.minIterations = std::max(1, std::atoi(argv[++i]));
+      } else if (arg == "--stress" && hasValue) {
+        options.stressRounds = std::max(1, std::atoi(argv[++i]));
+      } else if (arg == "--list") {
+        for (const auto& workload : makeWorkloads()) std::printf("%s\n", workload.name);
+        std::exit(0);
+      } else {
+        return false;
+      }
+    }
+
+    if (options.threadCounts.empty()) {
+      const int hardwareThreads = ResolveThreadCount(0);
+      for (int threads = 1; threads < hardwareThreads; threads *= 2) options.threadCounts.push_back(threads);
+      options.threadCounts.push_back(hardwareThreads);
+    }
+    return true;
+  }
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage();
+    return 1;
+  }
+
+  if (options.stressRounds > 0) {
+    int failedRounds = 0;
+    for (const int threads : options.threadCounts) {
+      JobSystem jobs(threads);
+      for (int round = 0; round < options.stressRounds; round++) failedRounds += !stressRound(jobs, uint32_t(round));
+      std::printf("%d threads: %d rounds done\n", threads, options.stressRounds);
+    }
+
+    if (failedRounds > 0) {
+      std::printf("%d round(s) failed\n", failedRounds);
+      return 1;
+    }
+    return 0;
+  }
+
+#ifndef NDEBUG
+  std::fprintf(stderr, "warning: assertions are enabled, build with CMAKE_BUILD_TYPE=Release for meaningful numbers\n");
+#endif
+
+  std::printf("%-20s %8s %11s %9s\n", "workload", "threads", "median ms", "speedup");
+  for (const auto& workload : makeWorkloads()) {
+    if (!options.filter.empty() && std::string(workload.name).find(options.filter) == std::string::npos) continue;
+
+    double baseMs = 0.0;
+    for (const int threads : options.threadCounts) {
+      JobSystem jobs(threads);
+      const double ms = medianTime(workload, jobs, options);
+      if (baseMs == 0.0) baseMs = ms;
+
+      std::printf("%-20s %8d %11.3f %8.2fx\n", workload.name, threads, ms, baseMs / ms);
+      std::fflush(stdout);
+    }
+  }
+
+  return 0;
+}
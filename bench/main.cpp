@@ -0,0 +1,453 @@
+// Seed-fixed microbenchmarks for the worldgen and autotile hot paths. Results can be written as JSON and
+// compared against a stored baseline, e.g.
+//   kingdom-bench --json baseline.json
+//   kingdom-bench --baseline baseline.json --threshold 10
+//   kingdom-bench --check-perlin    (exits with 1 when a batch kernel differs from the scalar noise)
+#include "game/terrain.h"
+#include "game/world_data.h"
+#include "game/world_generator.h"
+#include "graphics/tile_mesh.h"
+#include "math/perlin.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+  const uint32_t benchSeed = 8008135;
+  const char* terrainPath = "content/data/tileset.terrain";
+  const char* simdLevelNames[] = { "scalar", "sse2", "avx2" }; // by Perlin::SimdLevel
+
+  struct MapSize {
+    int width, height;
+  };
+  const MapSize defaultSizes[] = { { 256, 144 }, { 1024, 576 }, { 2048, 2048 }, { 8192, 8192 } };
+
+  struct Options {
+    std::vector<MapSize> sizes;
+    std::string filter;
+    std::string jsonPath;
+    std::string baselinePath;
+    double threshold = 10.0; // percent
+    double minTime = 0.5;    // seconds per case
+    int minIterations = 3;
+    int threads = 1;
+    bool checkPerlin = false;
+  };
+
+  struct Result {
+    std::string name;
+    MapSize size;
+    int iterations;
+    double minMs, medianMs, meanMs;
+    double itemsPerSecond;
+
+    std::string Key() const {
+      return name + "/" + std::to_string(size.width) + "x" + std::to_string(size.height);
+    }
+  };
+
+  // Inputs shared by all cases of one map size, generated once up front
+  struct Fixture {
+    MapSize size;
+    std::vector<uint8_t> levels;
+    std::vector<uint8_t> featureMap;
+    std::unique_ptr<WorldData> world;
+    std::vector<float> xs, ys, zs;
+    std::vector<uint8_t> bitmasks;
+    std::vector<TileVertex> vertices;
+    std::vector<TileInstance> instances;
+  };
+
+  struct Case {
+    const char* name;
+    std::function<size_t(Fixture&, const Options&)> prepare; // returns items processed per run
+    std::function<void(Fixture&, const Options&)> run;
+  };
+
+  // Keeps the optimizer from discarding results
+  volatile uint64_t sink = 0;
+
+  size_t tileCount(const Fixture& fixture) {
+    return size_t(fixture.size.width) * fixture.size.height;
+  }
+
+  std::vector<Case> makeCases() {
+    std::vector<Case> cases;
+    auto noisePoints = [](Fixture& f, const Options&) {
+      const size_t count = tileCount(f);
+      if (f.xs.size() != count) {
+        f.xs.resize(count); f.ys.resize(count); f.zs.assign(count, 0.f);
+        for (size_t i = 0; i < count; i++) {
+          f.xs[i] = 20.f * float(i % f.size.width) / float(f.size.width);
+          f.ys[i] = 20.f * float(i / f.size.width) / float(f.size.height);
+        }
+      }
+      return count;
+    };
+
+    cases.push_back({ "perlin_noise_scalar", noisePoints, [](Fixture& f, const Options&) {
+      Perlin perlin(benchSeed);
+      float sum = 0.f;
+      for (size_t i = 0; i < f.xs.size(); i++) sum += perlin.Noise(f.xs[i], f.ys[i], f.zs[i]);
+      sink += uint64_t(sum);
+    }});
+
+    cases.push_back({ "perlin_noise_batch", noisePoints, [](Fixture& f, const Options&) {
+      Perlin perlin(benchSeed);
+      std::vector<float> out(f.xs.size());
+      perlin.Noise(f.xs.data(), f.ys.data(), f.zs.data(), out.data(), out.size());
+      sink += uint64_t(out.back());
+    }});
+
+    cases.push_back({ "perlin_slice_batch", noisePoints, [](Fixture& f, const Options&) {
+      Perlin perlin(benchSeed);
+      const auto slice = perlin.SliceAt(0.f);
+      std::vector<float> out(f.xs.size());
+      slice.Noise(f.xs.data(), f.ys.data(), out.data(), out.size());
+      sink += uint64_t(out.back());
+    }});
+
+    cases.push_back({ "generate_heightmap", [](Fixture& f, const Options&) { return tileCount(f); },
+      [](Fixture& f, const Options& o) {
+        const auto heightmap = worldgen::GenerateHeightmap(benchSeed, f.size.width, f.size.height, o.threads);
+        sink += uint64_t(heightmap.back());
+      }});
+
+    cases.push_back({ "generate_elevation_levels", [](Fixture& f, const Options&) { return tileCount(f); },
+      [](Fixture& f, const Options& o) {
+        const auto levels = worldgen::GenerateElevationLevels(benchSeed, f.size.width, f.size.height, o.threads);
+        sink += levels.back();
+      }});
+
+    cases.push_back({ "generate_feature_map", [](Fixture& f, const Options&) { return tileCount(f); },
+      [](Fixture& f, const Options& o) {
+        const auto features = worldgen::GenerateFeatureMap(benchSeed, f.levels, f.size.width, f.size.height, o.threads);
+        sink += features.back();
+      }});
+
+    cases.push_back({ "calculate_bitmask", [](Fixture& f, const Options&) { return tileCount(f); },
+      [](Fixture& f, const Options&) {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < f.featureMap.size(); i++) {
+          sum += worldgen::calculateBitmask(f.featureMap, i, worldgen::landFeature, f.size.width);
+        }
+        sink += sum;
+      }});
+
+    cases.push_back({ "calculate_bitmasks", [](Fixture& f, const Options&) { return tileCount(f); },
+      [](Fixture& f, const Options&) {
+        f.bitmasks.resize(f.featureMap.size());
+        worldgen::calculateBitmasks(f.featureMap, worldgen::landFeature, f.size.width, 0, f.featureMap.size(), f.bitmasks.data());
+        sink += f.bitmasks.back();
+      }});
+
+    cases.push_back({ "create_tile_map", [](Fixture& f, const Options&) { return tileCount(f); },
+      [](Fixture& f, const Options& o) {
+        worldgen::CreateTileMap(*f.world, benchSeed, o.threads);
+        sink += f.world->validTileCount;
+      }});
+
+    cases.push_back({ "terrain_get_tile_index", [](Fixture& f, const Options&) {
+        f.bitmasks.resize(f.featureMap.size());
+        worldgen::calculateBitmasks(f.featureMap, worldgen::landFeature, f.size.width, 0, f.featureMap.size(), f.bitmasks.data());
+        return tileCount(f);
+      },
+      [](Fixture& f, const Options&) {
+        const auto& terrain = f.world->terrainSet;
+        const int land = terrain.GetTerrainId("land");
+        uint64_t sum = 0;
+        for (auto bitmask : f.bitmasks) sum += terrain.GetTileIndex(land, bitmask);
+        sink += sum;
+      }});
+
+    cases.push_back({ "tile_map_generate_buffer", [](Fixture& f, const Options&) {
+        f.vertices.resize(f.world->validTileCount * TileVerticesPerTile);
+        return f.world->tileData.size();
+      },
+      [](Fixture& f, const Options& o) {
+        // TileMap::GenerateBuffer minus the GL upload
+        const TileRect map{ 0, 0, f.size.width, f.size.height };
+        sink += BuildTileVertices(f.world->tileData, f.size.width, f.size.height, map, f.vertices.data(), o.threads);
+      }});
+
+    cases.push_back({ "tile_map_generate_instances", [](Fixture& f, const Options&) {
+        f.instances.resize(f.world->validTileCount);
+        return f.world->tileData.size();
+      },
+      [](Fixture& f, const Options& o) {
+        const TileRect map{ 0, 0, f.size.width, f.size.height };
+        sink += BuildTileInstances(f.world->tileData, f.size.width, f.size.height, map, f.instances.data(), o.threads);
+      }});
+
+    cases.push_back({ "tile_map_build_chunks", [](Fixture& f, const Options&) {
+        return f.world->tileData.size();
+      },
+      [](Fixture& f, const Options& o) {
+        sink += BuildTileChunks(f.world->tileData, f.size.width, f.size.height, o.threads).size();
+      }});
+
+    return cases;
+  }
+
+  Fixture makeFixture(MapSize size, int threads) {
+    Fixture fixture;
+    fixture.size = size;
+    fixture.levels = worldgen::GenerateElevationLevels(benchSeed, size.width, size.height, threads);
+    fixture.featureMap = worldgen::GenerateFeatureMap(benchSeed, fixture.levels, size.width, size.height, threads);
+
+    fixture.world = std::make_unique<WorldData>(terrainPath, size.width, size.height, 5);
+    fixture.world->heightmap = fixture.levels;
+    fixture.world->featuremap = fixture.featureMap;
+    worldgen::CreateTileMap(*fixture.world, benchSeed, threads);
+
+    return fixture;
+  }
+
+  Result runCase(const Case& benchCase, Fixture& fixture, const Options& options) {
+    using Clock = std::chrono::steady_clock;
+    const size_t items = benchCase.prepare(fixture, options);
+    benchCase.run(fixture, options); // warm up
+
+    std::vector<double> samples;
+    double total = 0.0;
+    while (int(samples.size()) < options.minIterations || total < options.minTime * 1000.0) {
+      const auto start = Clock::now();
+      benchCase.run(fixture, options);
+      const double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+      samples.push_back(ms);
+      total += ms;
+      if (samples.size() >= 1000) break;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    Result result;
+    result.name = benchCase.name;
+    result.size = fixture.size;
+    result.iterations = int(samples.size());
+    result.minMs = samples.front();
+    result.medianMs = samples[samples.size() / 2];
+    result.meanMs = total / double(samples.size());
+    result.itemsPerSecond = double(items) / (result.medianMs / 1000.0);
+    return result;
+  }
+
+  bool writeJson(const std::string& path, const std::vector<Result>& results) {
+    std::ofstream file(path);
+    if (!file) return false;
+
+    file << "{\n  \"seed\": " << benchSeed << ",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+      const auto& r = results[i];
+      char line[512];
+      std::snprintf(line, sizeof(line),
+                    "    { \"name\": \"%s\", \"width\": %d, \"height\": %d, \"iterations\": %d, "
+                    "\"min_ms\": %.4f, \"median_ms\": %.4f, \"mean_ms\": %.4f, \"items_per_second\": %.1f }%s\n",
+                    r.name.c_str(), r.size.width, r.size.height, r.iterations,
+                    r.minMs, r.medianMs, r.meanMs, r.itemsPerSecond, i + 1 < results.size() ? "," : "");
+      file << line;
+    }
+    file << "  ]\n}\n";
+
+    return bool(file);
+  }
+
+  // Reads back the files writeJson produces, keyed by name/WxH -> median_ms
+  bool readBaseline(const std::string& path, std::map<std::string, double>& medians) {
+    std::ifstream file(path);
+    if (!file) return false;
+
+    std::string line;
+    while (std::getline(file, line)) {
+      char name[128];
+      int width, height;
+      const auto namePos = line.find("\"name\"");
+      const auto medianPos = line.find("\"median_ms\"");
+      if (namePos == std::string::npos || medianPos == std::string::npos) continue;
+
+      if (std::sscanf(line.c_str() + namePos, "\"name\": \"%127[^\"]\", \"width\": %d, \"height\": %d", name, &width, &height) != 3) continue;
+      const double median = std::atof(line.c_str() + line.find(':', medianPos) + 1);
+      medians[std::string(name) + "/" + std::to_string(width) + "x" + std::to_string(height)] = median;
+    }
+    return true;
+  }
+
+  // Compares every batch kernel the CPU supports bit for bit against the scalar noise, returns the mismatch count
+  uint64_t checkPerlinKernels() {
+    // Lattice points, negative coordinates, a count that leaves a tail for every kernel width
+    const size_t count = 4099;
+    std::vector<float> xs(count), ys(count), zs(count);
+    uint32_t state = benchSeed;
+    const auto next = [&state]() { state = state * 1664525u + 1013904223u; return float(state >> 8) / float(1 << 24); };
+    for (size_t i = 0; i < count; i++) {
+      xs[i] = i % 7 == 0 ? float(int(i % 300) - 150) : next() * 600.f - 300.f;
+      ys[i] = i % 5 == 0 ? float(int(i % 200) - 100) : next() * 600.f - 300.f;
+      zs[i] = i % 3 == 0 ? 0.f : next() * 20.f - 10.f;
+    }
+
+    uint64_t mismatches = 0;
+    const auto compare = [&mismatches](const char* what, const char* level, const std::vector<float>& batch,
+                                       const std::vector<float>& scalar) {
+      for (size_t i = 0; i < batch.size(); i++) {
+        if (std::memcmp(&batch[i], &scalar[i], sizeof(float)) == 0) continue;
+        if (mismatches++ < 10) std::printf("%s/%s: sample %zu is %.9g, scalar %.9g\n", what, level, i, batch[i], scalar[i]);
+      }
+    };
+
+    const auto previousLevel = Perlin::ActiveSimdLevel();
+    Perlin perlin(benchSeed);
+    std::vector<float> scalar(count), batch(count);
+    for (int level = 0; level <= int(Perlin::SupportedSimdLevel()); level++) {
+      Perlin::SetSimdLevel(Perlin::SimdLevel(level));
+
+      for (size_t i = 0; i < count; i++) scalar[i] = perlin.Noise(xs[i], ys[i], zs[i]);
+      perlin.Noise(xs.data(), ys.data(), zs.data(), batch.data(), count);
+      compare("noise", simdLevelNames[level], batch, scalar);
+
+      for (const float z : { 0.f, 2.f, 0.37f, -5.5f }) {
+        const auto slice = perlin.SliceAt(z);
+        for (size_t i = 0; i < count; i++) scalar[i] = slice.Noise(xs[i], ys[i]);
+        slice.Noise(xs.data(), ys.data(), batch.data(), count);
+        compare("slice", simdLevelNames[level], batch, scalar);
+      }
+    }
+    Perlin::SetSimdLevel(previousLevel);
+
+    return mismatches;
+  }
+
+  void printUsage() {
+    std::printf(
+        "usage: kingdom-bench [options]\n"
+        "  --sizes <list>       comma separated WxH sizes (default 256x144,1024x576,2048x2048,8192x8192)\n"
+        "  --filter <text>      only run cases whose name contains text\n"
+        "  --json <path>        write the results as JSON\n"
+        "  --baseline <path>    compare against a JSON file written by --json\n"
+        "  --threshold <pct>    median slowdown that counts as a regression (default 10)\n"
+        "  --min-time <sec>     minimum measured time per case (default 0.5)\n"
+        "  --iterations <n>     minimum iterations per case (default 3)\n"
+        "  --threads <n>        worldgen and mesh threads, 0 uses every hardware thread (default 1)\n"
+        "  --check-perlin       check the batch noise kernels against the scalar path and exit\n"
+        "  --list               list the cases and exit\n");
+  }
+
+  bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+      const std::string arg = argv[i];
+      const bool hasValue = i + 1 < argc;
+
+      if (arg == "--sizes" && hasValue) {
+        std::stringstream list(argv[++i]);
+        std::string token;
+        while (std::getline(list, token, ',')) {
+          MapSize size{};
+          if (std::sscanf(token.c_str(), "%dx%d", &size.width, &size.height) != 2 || size.width <= 0 || size.height <= 0) return false;
+          options.sizes.push_back(size);
+        }
+      } else if (arg == "--filter" && hasValue) {
+        options.filter = argv[++i];
+      } else if (arg == "--json" && hasValue) {
+        options.jsonPath = argv[++i];
+      } else if (arg == "--baseline" && hasValue) {
+        options.baselinePath = argv[++i];
+      } else if (arg == "--threshold" && hasValue) {
+        options.threshold = std::atof(argv[++i]);
+      } else if (arg == "--min-time" && hasValue) {
+        options.minTime = std::atof(argv[++i]);
+      } else if (arg == "--iterations" && hasValue) {
+        options.minIterations = std::max(1, std::atoi(argv[++i]));
+      } else if (arg == "--threads" && hasValue) {
+        options.threads = std::atoi(argv[++i]);
+      } else if (arg == "--check-perlin") {
+        options.checkPerlin = true;
+      } else if (arg == "--list") {
+        for (const auto& benchCase : makeCases()) std::printf("%s\n", benchCase.name);
+        std::exit(0);
+      } else {
+        return false;
+      }
+    }
+
+    if (options.sizes.empty()) options.sizes.assign(std::begin(defaultSizes), std::end(defaultSizes));
+    return true;
+  }
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage();
+    return 1;
+  }
+
+  if (options.checkPerlin) {
+    const uint64_t mismatches = checkPerlinKernels();
+    if (mismatches > 0) {
+      std::printf("%llu batch noise sample(s) differ from the scalar path\n", (unsigned long long)mismatches);
+      return 1;
+    }
+    std::printf("batch noise matches the scalar path up to %s\n", simdLevelNames[int(Perlin::SupportedSimdLevel())]);
+    return 0;
+  }
+
+#ifndef NDEBUG
+  std::fprintf(stderr, "warning: assertions are enabled, build with CMAKE_BUILD_TYPE=Release for meaningful numbers\n");
+#endif
+
+  std::map<std::string, double> baseline;
+  if (!options.baselinePath.empty() && !readBaseline(options.baselinePath, baseline)) {
+    std::fprintf(stderr, "failed to read baseline %s\n", options.baselinePath.c_str());
+    return 1;
+  }
+
+  const auto cases = makeCases();
+  std::vector<Result> results;
+  int regressions = 0;
+
+  std::printf("%-28s %11s %6s %11s %11s %14s %9s\n", "case", "size", "iters", "min ms", "median ms", "items/s", "vs base");
+  for (const auto size : options.sizes) {
+    auto fixture = makeFixture(size, options.threads);
+
+    for (const auto& benchCase : cases) {
+      if (!options.filter.empty() && std::string(benchCase.name).find(options.filter) == std::string::npos) continue;
+
+      const auto result = runCase(benchCase, fixture, options);
+      results.push_back(result);
+
+      char comparison[32] = "";
+      const auto base = baseline.find(result.Key());
+      if (base != baseline.end() && base->second > 0.0) {
+        const double change = (result.medianMs / base->second - 1.0) * 100.0;
+        const bool regressed = change > options.threshold;
+        std::snprintf(comparison, sizeof(comparison), "%+.1f%%%s", change, regressed ? " !" : "");
+        regressions += regressed;
+      }
+
+      const std::string sizeText = std::to_string(size.width) + "x" + std::to_string(size.height);
+      std::printf("%-28s %11s %6d %11.3f %11.3f %14.4g %9s\n", result.name.c_str(), sizeText.c_str(),
+                  result.iterations, result.minMs, result.medianMs, result.itemsPerSecond, comparison);
+      std::fflush(stdout);
+    }
+  }
+
+  if (!options.jsonPath.empty() && !writeJson(options.jsonPath, results)) {
+    std::fprintf(stderr, "failed to write %s\n", options.jsonPath.c_str());
+    return 1;
+  }
+
+  if (regressions > 0) {
+    std::printf("%d case(s) regressed by more than %.1f%% against %s\n", regressions, options.threshold, options.baselinePath.c_str());
+    return 2;
+  }
+
+  return 0;
+}
@@ -0,0 +1,512 @@
+// Headless render benchmarks for the tile map and sprite batch. Every case is drawn from a few scripted camera
+// shots into an offscreen framebuffer, timed until glFinish returns, and optionally compared against golden images:
+//   kingdom-render-bench --golden golden                   (exits with 2 when a frame differs or its golden image
+//                                                           is missing)
+//   kingdom-render-bench --golden golden --update-golden   (writes golden/<case>_<shot>.png)
+//
+// The golden images in bench/render/golden (copied next to the binary as golden/) are rendered with Mesa's
+// llvmpipe at the defaults: seed 8008135, 256x144 map, 1280x720 frame, 20000 sprites. Other drivers round
+// texture coordinates and blending slightly differently, so a pixel still matches when every channel is within
+// --tolerance (2) of the golden one, and a frame passes while at most --max-mismatch (0.1%) of its pixels don't.
+// A real rendering change (a missing layer, a wrong tile, an off-by-one camera) moves far more pixels than that.
+#include "core/headless_context.h"
+#include "content/file_handler.h"
+#include "game/building_data.h"
+#include "game/building_instances.h"
+#include "game/minimap.h"
+#include "game/world_data.h"
+#include "game/world_generator.h"
+#include "graphics/building_renderer.h"
+#include "graphics/grid_overlay.h"
+#include "graphics/shader_program.h"
+#include "graphics/sprite_batch.h"
+#include "graphics/texture_2d.h"
+#include "graphics/tile_animation.h"
+#include "graphics/tile_map.h"
+#include "graphics/tile_sheet.h"
+#include "graphics/stb_image.h"
+#include "glad/glad.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include "spdlog/spdlog.h"
+#include "zlib.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+  const uint32_t benchSeed = 8008135;
+  const char* terrainPath = "content/data/tileset.terrain";
+  const char* tilesetPath = "content/textures/tileset.png";
+  const int tileSize = 16;
+
+  struct Options {
+    int mapWidth = 256, mapHeight = 144;
+    int frameWidth = 1280, frameHeight = 720;
+    int sprites = 20000;
+    std::string filter;
+    std::string jsonPath;
+    std::string goldenDir;
+    bool updateGolden = false;
+    int tolerance = 2;         // per channel
+    double maxMismatch = 0.1;  // percent of pixels outside the tolerance
+    double minTime = 0.25;     // seconds per case and shot
+    int minIterations = 10;
+  };
+
+  // Scripted camera, center is in tiles
+  struct Shot {
+    const char* name;
+    glm::vec2 center;
+    float zoom;
+  };
+
+  std::vector<Shot> makeShots(const Options& options) {
+    const glm::vec2 mapSize(options.mapWidth, options.mapHeight);
+    return {
+        { "center", mapSize * 0.5f, 1.f },
+        { "zoom_in", mapSize * 0.25f, 3.f },
+        { "zoom_out", mapSize * 0.5f, 0.25f },
+        { "map_corner", mapSize, 1.f },
+    };
+  }
+
+  // Everything the cases draw, created once up front
+  struct Scene {
+    const Options& options;
+    WorldData world;
+    entt::registry registry;
+    BuildingInstances buildings;
+
+    TileSheet tilesheet;
+    TileAnimationTexture tileAnimations;
+    TileMap instancedMap, vertexMap;
+    ShaderProgram instancedProgram, vertexProgram;
+    BuildingRenderer buildingRenderer;
+    GridOverlay grid;
+
+    SpriteBatch spriteBatch;
+    Texture2D spriteSheet;
+    Texture2D minimap;
+    std::vector<glm::vec2> spritePositions;
+    std::vector<glm::vec4> spriteUVs;
+
+    glm::mat4 proj;
+    glm::mat4 camera;
+
+    explicit Scene(const Options& options)
+      : options(options),
+        world(worldgen::GenerateGameWorld(terrainPath, benchSeed, options.mapWidth, options.mapHeight)),
+        buildings(registry),
+        tilesheet(tilesetPath, tileSize),
+        tileAnimations(world.animTable, tilesheet.Width() * tilesheet.Height()),
+        instancedMap(options.mapWidth, options.mapHeight, TileMapMode::Instanced),
+        vertexMap(options.mapWidth, options.mapHeight, TileMapMode::Vertices),
+        instancedProgram(ReadTextFile(instancedMap.VertexShaderPath()), ReadTextFile("content/shaders/texturedFS.glsl")),
+        vertexProgram(ReadTextFile(vertexMap.VertexShaderPath()), ReadTextFile("content/shaders/texturedFS.glsl")),
+        buildingRenderer(tilesheet, tileAnimations),
+        grid(options.frameWidth, options.frameHeight),
+        spriteBatch(options.frameWidth, options.frameHeight),
+        spriteSheet(tilesetPath),
+        minimap(options.mapWidth, options.mapHeight),
+        proj(glm::ortho(0.f, float(options.frameWidth), float(options.frameHeight), 0.f, -10.f, 10.f)),
+        camera(1.f)
+    {
+      // Both modes show animation frame 0, the vertex map has it baked in
+      instancedMap.GenerateBuffer(world.tileData);
+      vertexMap.GenerateAnimatedBuffer(world.tileData, world.tileFlags, world.animTable, 0);
+      for (auto* program : { &instancedProgram, &vertexProgram }) {
+        program->Use();
+        program->SetUniform("proj", proj);
+        program->SetUniform("model", glm::mat4(1.f));
+        program->SetUniform("tileSize", tilesheet.TileSize());
+        program->SetUniform("sheetColumns", tilesheet.Width());
+        program->SetUniform("sheetRows", tilesheet.Height());
+        program->SetUniform("animLookup", 1);
+        program->SetUniform("animFrame", 0);
+      }
+
+      // A building every 7 tiles along every 5th row
+      for (int y = 2; y < options.mapHeight; y += 5) {
+        for (int x = (y * 3) % 7; x < options.mapWidth; x += 7) {
+          registry.emplace<BuildingData>(registry.create(), 730, x, y);
+        }
+      }
+      buildingRenderer.Update(buildings.Instances());
+
+      const auto minimapPixels = worldgen::GenerateMinimapPixels(world.featuremap);
+      minimap.SetTextureData(minimapPixels.data());
+
+      // Sprites scattered over the map, each showing a random tile of the sheet
+      uint32_t state = benchSeed;
+      const auto next = [&state]() { state = state * 1664525u + 1013904223u; return state >> 8; };
+      const float columns = float(tilesheet.Width()), rows = float(tilesheet.Height());
+      for (int i = 0; i < options.sprites; i++) {
+        spritePositions.emplace_back(float(next() % uint32_t(options.mapWidth * tileSize)),
+                                     float(next() % uint32_t(options.mapHeight * tileSize)));
+        const float column = float(next() % uint32_t(columns)), row = float(next() % uint32_t(rows));
+        spriteUVs.emplace_back(column / columns, row / rows, (column + 1.f) / columns, (row + 1.f) / rows);
+      }
+    }
+
+    void SetShot(const Shot& shot) {
+      const glm::vec2 screenCenter(options.frameWidth * 0.5f, options.frameHeight * 0.5f);
+      camera = glm::scale(glm::mat4(1.f), glm::vec3(shot.zoom));
+      camera = glm::translate(camera, glm::vec3(screenCenter / shot.zoom - shot.center * float(tileSize), 0.f));
+
+      for (auto* program : { &instancedProgram, &vertexProgram }) {
+        program->Use();
+        program->SetUniform("view", camera);
+      }
+    }
+
+    void DrawTileMap(TileMap& tileMap, ShaderProgram& program) {
+      program.Use();
+      tilesheet.Bind();
+      tileAnimations.Bind(1);
+      tileMap.Draw(VisibleTileRect(camera, float(options.frameWidth), float(options.frameHeight), tileSize));
+    }
+
+    void DrawSprites() {
+      spriteBatch.Begin(camera);
+      for (size_t i = 0; i < spritePositions.size(); i++) {
+        const auto model = glm::scale(glm::translate(glm::mat4(1.f), glm::vec3(spritePositions[i], 0.f)),
+                                      glm::vec3(float(tileSize), float(tileSize), 1.f));
+        spriteBatch.Draw(spriteSheet, model, spriteUVs[i], glm::vec4(1.f), int(i % 2));
+      }
+      spriteBatch.End();
+    }
+
+    // Same passes as the game's main loop
+    void DrawFrame() {
+      DrawTileMap(instancedMap, instancedProgram);
+      buildingRenderer.Draw(proj, camera, 0);
+      grid.Draw(camera, glm::vec2(options.mapWidth, options.mapHeight) * float(tileSize), float(tileSize));
+
+      spriteBatch.Begin();
+      spriteBatch.Draw(minimap, glm::vec2(options.frameWidth - minimap.Width() - 10.f, 10.f), glm::vec2(1.f));
+      spriteBatch.End();
+    }
+  };
+
+  struct Case {
+    const char* name;
+    std::function<void(Scene&)> draw;
+  };
+
+  std::vector<Case> makeCases() {
+    return {
+        { "tile_map_instanced", [](Scene& scene) { scene.DrawTileMap(scene.instancedMap, scene.instancedProgram); } },
+        { "tile_map_vertices", [](Scene& scene) { scene.DrawTileMap(scene.vertexMap, scene.vertexProgram); } },
+        { "sprite_batch", [](Scene& scene) { scene.DrawSprites(); } },
+        { "frame", [](Scene& scene) { scene.DrawFrame(); } },
+    };
+  }
+
+  struct Result {
+    std::string name;
+    std::string shot;
+    int iterations;
+    double minMs, medianMs, meanMs;
+  };
+
+  void renderFrame(const Case& renderCase, Scene& scene) {
+    glClearColor(1.f, 1.f, 1.f, 1.f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    renderCase.draw(scene);
+  }
+
+  Result runCase(const Case& renderCase, const Shot& shot, Scene& scene, const Options& options) {
+    using Clock = std::chrono::steady_clock;
+    scene.SetShot(shot);
+    renderFrame(renderCase, scene); // warm up
+    glFinish();
+
+    std::vector<double> samples;
+    double total = 0.0;
+    while (int(samples.size()) < options.minIterations || total < options.minTime * 1000.0) {
+      const auto start = Clock::now();
+      renderFrame(renderCase, scene);
+      glFinish();
+      const double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+      samples.push_back(ms);
+      total += ms;
+      if (samples.size() >= 1000) break;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    Result result;
+    result.name = renderCase.name;
+    result.shot = shot.name;
+    result.iterations = int(samples.size());
+    result.minMs = samples.front();
+    result.medianMs = samples[samples.size() / 2];
+    result.meanMs = total / double(samples.size());
+    return result;
+  }
+
+  void writeChunk(std::ofstream& file, const char* type, const std::vector<uint8_t>& data) {
+    const uint8_t length[4] = { uint8_t(data.size() >> 24), uint8_t(data.size() >> 16), uint8_t(data.size() >> 8),
+                                uint8_t(data.size()) };
+    uLong crc = crc32(0, reinterpret_cast<const Bytef*>(type), 4);
+    crc = crc32(crc, data.data(), uInt(data.size()));
+    const uint8_t crcBytes[4] = { uint8_t(crc >> 24), uint8_t(crc >> 16), uint8_t(crc >> 8), uint8_t(crc) };
+
+    file.write(reinterpret_cast<const char*>(length), 4);
+    file.write(type, 4);
+    file.write(reinterpret_cast<const char*>(data.data()), std::streamsize(data.size()));
+    file.write(reinterpret_cast<const char*>(crcBytes), 4);
+  }
+
+  // 8 bit RGB PNG, every frame is opaque. Rows use the Up filter, tiles repeat vertically and compress far better.
+  bool writeImage(const std::string& path, const std::vector<uint8_t>& rgba, int width, int height) {
+    const size_t stride = size_t(width) * 3 + 1;
+    std::vector<uint8_t> rows(stride * height);
+    for (int y = 0; y < height; y++) {
+      uint8_t* row = &rows[stride * y];
+      row[0] = 2; // Up
+      for (int x = 0; x < width; x++) {
+        for (int c = 0; c < 3; c++) {
+          const size_t i = (size_t(y) * width + x) * 4 + c;
+          row[1 + x * 3 + c] = uint8_t(rgba[i] - (y > 0 ? rgba[i - size_t(width) * 4] : 0));
+        }
+      }
+    }
+
+    uLongf compressedSize = compressBound(uLong(rows.size()));
+    std::vector<uint8_t> compressed(compressedSize);
+    if (compress2(compressed.data(), &compressedSize, rows.data(), uLong(rows.size()), Z_BEST_COMPRESSION) != Z_OK) return false;
+    compressed.resize(compressedSize);
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file) return false;
+
+    const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    file.write(reinterpret_cast<const char*>(signature), 8);
+    const std::vector<uint8_t> header = {
+        uint8_t(width >> 24), uint8_t(width >> 16), uint8_t(width >> 8), uint8_t(width),
+        uint8_t(height >> 24), uint8_t(height >> 16), uint8_t(height >> 8), uint8_t(height),
+        8, 2, 0, 0, 0 // 8 bit, RGB, deflate, adaptive filtering, no interlace
+    };
+    writeChunk(file, "IHDR", header);
+    writeChunk(file, "IDAT", compressed);
+    writeChunk(file, "IEND", {});
+    return bool(file);
+  }
+
+  bool readImage(const std::string& path, std::vector<uint8_t>& rgb, int& width, int& height) {
+    uint8_t* data = stbi_load(path.c_str(), &width, &height, nullptr, STBI_rgb);
+    if (!data) return false;
+
+    rgb.assign(data, data + size_t(width) * height * 3);
+    stbi_image_free(data);
+    return true;
+  }
+
+  // Returns the percentage of pixels with a channel further than tolerance from the golden image, 100 when the
+  // image can't be read or the sizes differ
+  double compareImage(const std::string& path, const std::vector<uint8_t>& rgba, int width, int height, int tolerance) {
+    std::vector<uint8_t> golden;
+    int goldenWidth, goldenHeight;
+    if (!readImage(path, golden, goldenWidth, goldenHeight) || goldenWidth != width || goldenHeight != height) return 100.0;
+
+    size_t mismatches = 0;
+    const size_t count = size_t(width) * height;
+    for (size_t i = 0; i < count; i++) {
+      for (int c = 0; c < 3; c++) {
+        if (std::abs(int(rgba[i * 4 + c]) - int(golden[i * 3 + c])) > tolerance) {
+          mismatches++;
+          break;
+        }
+      }
+    }
+    return 100.0 * double(mismatches) / double(count);
+  }
+
+  bool writeJson(const std::string& path, const Options& options, const std::vector<Result>& results) {
+    std::ofstream file(path);
+    if (!file) return false;
+
+    file << "{\n  \"seed\": " << benchSeed << ", \"map\": \"" << options.mapWidth << "x" << options.mapHeight
+         << "\", \"frame\": \"" << options.frameWidth << "x" << options.frameHeight << "\",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+      const auto& r = results[i];
+      char line[512];
+      std::snprintf(line, sizeof(line),
+                    "    { \"name\": \"%s\", \"shot\": \"%s\", \"iterations\": %d, "
+                    "\"min_ms\": %.4f, \"median_ms\": %.4f, \"mean_ms\": %.4f }%s\n",
+                    r.name.c_str(), r.shot.c_str(), r.iterations, r.minMs, r.medianMs, r.meanMs,
+                    i + 1 < results.size() ? "," : "");
+      file << line;
+    }
+    file << "  ]\n}\n";
+
+    return bool(file);
+  }
+
+  void printUsage() {
+    std::printf(
+        "usage: kingdom-render-bench [options]\n"
+        "  --map <WxH>          map size in tiles (default 256x144)\n"
+        "  --frame <WxH>        framebuffer size in pixels (default 1280x720)\n"
+        "  --sprites <n>        sprites drawn by the sprite_batch case (default 20000)\n"
+        "  --filter <text>      only run cases whose name contains text\n"
+        "  --json <path>        write the frame times as JSON\n"
+        "  --golden <dir>       compare every frame against <dir>/<case>_<shot>.png\n"
+        "  --update-golden      write the golden images instead of comparing\n"
+        "  --tolerance <n>      per channel difference still counted as a match (default 2)\n"
+        "  --max-mismatch <pct> pixels allowed outside the tolerance (default 0.1)\n"
+        "  --min-time <sec>     minimum measured time per case and shot (default 0.25)\n"
+        "  --iterations <n>     minimum frames per case and shot (default 10)\n"
+        "  --list               list the cases and shots and exit\n");
+  }
+
+  bool parseSize(const char* text, int& width, int& height) {
+    return std::sscanf(text, "%dx%d", &width, &height) == 2 && width > 0 && height > 0;
+  }
+
+  bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+      const std::string arg = argv[i];
+      const bool hasValue = i + 1 < argc;
+
+      if (arg == "--map" && hasValue) {
+        if (!parseSize(argv[++i], options.mapWidth, options.mapHeight)) return false;
+      } else if (arg == "--frame" && hasValue) {
+        if (!parseSize(argv[++i], options.frameWidth, options.frameHeight)) return false;
+      } else if (arg == "--sprites" && hasValue) {
+        options.sprites = std::max(0, std::atoi(argv[++i]));
+      } else if (arg == "--filter" && hasValue) {
+        options.filter = argv[++i];
+      } else if (arg == "--json" && hasValue) {
+        options.jsonPath = argv[++i];
+      } else if (arg == "--golden" && hasValue) {
+        options.goldenDir = argv[++i];
+      } else if (arg == "--update-golden") {
+        options.updateGolden = true;
+      } else if (arg == "--tolerance" && hasValue) {
+        options.tolerance = std::atoi(argv[++i]);
+      } else if (arg == "--max-mismatch" && hasValue) {
+        options.maxMismatch = std::atof(argv[++i]);
+      } else if (arg == "--min-time" && hasValue) {
+        options.minTime = std::atof(argv[++i]);
+      } else if (arg == "--iterations" && hasValue) {
+        options.minIterations = std::max(1, std::atoi(argv[++i]));
+      } else if (arg == "--list") {
+        for (const auto& renderCase : makeCases()) {
+          for (const auto& shot : makeShots(options)) std::printf("%s_%s\n", renderCase.name, shot.name);
+        }
+        std::exit(0);
+      } else {
+        return false;
+      }
+    }
+
+    return !options.updateGolden || !options.goldenDir.empty();
+  }
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage();
+    return 1;
+  }
+
+#ifndef NDEBUG
+  std::fprintf(stderr, "warning: assertions are enabled, build with CMAKE_BUILD_TYPE=Release for meaningful numbers\n");
+#endif
+  spdlog::set_level(spdlog::level::warn);
+
+  HeadlessContext context(options.frameWidth, options.frameHeight);
+  if (!context.IsValid()) {
+    std::fprintf(stderr, "failed to create a headless OpenGL context\n");
+    return 1;
+  }
+
+  if (options.updateGolden) {
+    std::error_code error;
+    std::filesystem::create_directories(options.goldenDir, error);
+    if (error) {
+      std::fprintf(stderr, "failed to create %s: %s\n", options.goldenDir.c_str(), error.message().c_str());
+      return 1;
+    }
+  } else if (!options.goldenDir.empty() && !std::filesystem::is_directory(options.goldenDir)) {
+    std::fprintf(stderr, "golden directory %s is missing, create it with --update-golden\n", options.goldenDir.c_str());
+    return 1;
+  }
+
+  Scene scene(options);
+  const auto shots = makeShots(options);
+  std::vector<Result> results;
+  int mismatches = 0;
+  int missing = 0;
+
+  std::printf("%-20s %-12s %6s %10s %11s %10s %10s\n", "case", "shot", "frames", "min ms", "median ms", "mean ms", "golden");
+  for (const auto& renderCase : makeCases()) {
+    if (!options.filter.empty() && std::string(renderCase.name).find(options.filter) == std::string::npos) continue;
+
+    for (const auto& shot : shots) {
+      context.Bind();
+      const auto result = runCase(renderCase, shot, scene, options);
+      results.push_back(result);
+
+      char golden[32] = "";
+      if (!options.goldenDir.empty()) {
+        const auto pixels = context.ReadPixels();
+        const std::string path = options.goldenDir + "/" + result.name + "_" + result.shot + ".png";
+
+        if (options.updateGolden) {
+          if (!writeImage(path, pixels, context.Width(), context.Height())) {
+            std::fprintf(stderr, "failed to write %s\n", path.c_str());
+            return 1;
+          }
+          std::snprintf(golden, sizeof(golden), "written");
+        } else if (!std::filesystem::exists(path)) {
+          missing++;
+          std::snprintf(golden, sizeof(golden), "missing !");
+        } else {
+          const double mismatch = compareImage(path, pixels, context.Width(), context.Height(), options.tolerance);
+          const bool failed = mismatch > options.maxMismatch;
+          std::snprintf(golden, sizeof(golden), "%.2f%%%s", mismatch, failed ? " !" : "");
+
+          // Keep the failing frame next to the golden image for inspection
+          if (failed) {
+            mismatches++;
+            const std::string actualPath = options.goldenDir + "/" + result.name + "_" + result.shot + ".actual.png";
+            if (!writeImage(actualPath, pixels, context.Width(), context.Height())) {
+              std::fprintf(stderr, "failed to write %s\n", actualPath.c_str());
+            }
+          }
+        }
+      }
+
+      std::printf("%-20s %-12s %6d %10.3f %11.3f %10.3f %10s\n", result.name.c_str(), result.shot.c_str(),
+                  result.iterations, result.minMs, result.medianMs, result.meanMs, golden);
+      std::fflush(stdout);
+    }
+  }
+
+  if (!options.jsonPath.empty() && !writeJson(options.jsonPath, options, results)) {
+    std::fprintf(stderr, "failed to write %s\n", options.jsonPath.c_str());
+    return 1;
+  }
+
+  if (missing > 0) {
+    std::printf("%d golden image(s) missing in %s, write them with --update-golden\n", missing, options.goldenDir.c_str());
+  }
+  if (mismatches > 0) {
+    std::printf("%d frame(s) differ from the golden images in %s by more than %.2f%% of their pixels\n",
+                mismatches, options.goldenDir.c_str(), options.maxMismatch);
+  }
+  if (missing > 0 || mismatches > 0) return 2;
+
+  return 0;
+}
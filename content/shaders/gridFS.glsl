@@ -0,0 +1,26 @@
+#version 400
+in vec2 WorldPos;
+
+out vec4 fragColor;
+
+uniform float cellSize;
+uniform vec4 lineColor;
+uniform float lineWidth; // in screen pixels
+
+void main() {
+    vec2 cellsPerPixel = fwidth(WorldPos / cellSize);
+    vec2 pixelsPerCell = 1.0 / cellsPerPixel;
+
+    // shifted by half a pixel so lines start on a pixel instead of straddling two at integer zoom levels
+    vec2 cell = WorldPos / cellSize - 0.5 * cellsPerPixel;
+
+    // screen pixels to the closest line, with a one pixel soft edge
+    vec2 lineDistance = abs(fract(cell + 0.5) - 0.5) * pixelsPerCell;
+    float coverage = 1.0 - smoothstep(lineWidth * 0.5 - 0.5, lineWidth * 0.5 + 0.5, min(lineDistance.x, lineDistance.y));
+
+    // fade the grid out once the cells get so small it would just tint the whole map
+    coverage *= clamp(min(pixelsPerCell.x, pixelsPerCell.y) / 4.0 - 0.5, 0.0, 1.0);
+    if (coverage <= 0.0) discard;
+
+    fragColor = vec4(lineColor.rgb, lineColor.a * coverage);
+}
@@ -0,0 +1,15 @@
+#version 400
+out vec2 WorldPos;
+
+uniform mat4 proj;
+uniform mat4 view;
+
+// world space extent of the grid
+uniform vec2 gridSize;
+
+void main() {
+    // one quad over the whole grid, drawn as a 4 vertex triangle strip
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    WorldPos = corner * gridSize;
+    gl_Position = proj * view * vec4(WorldPos, 0.0, 1.0);
+}
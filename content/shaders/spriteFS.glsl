@@ -0,0 +1,11 @@
+#version 400
+in vec2 UV;
+in vec4 Tint;
+
+out vec4 fragColor;
+
+uniform sampler2D image;
+
+void main() {
+    fragColor = texture(image, UV) * Tint;
+}
@@ -0,0 +1,16 @@
+#version 400
+layout(location = 0) in vec2 aPos;
+layout(location = 1) in vec2 aUV;
+layout(location = 2) in vec4 aTint;
+
+out vec2 UV;
+out vec4 Tint;
+
+uniform mat4 proj;
+uniform mat4 view;
+
+void main() {
+    UV = aUV;
+    Tint = aTint;
+    gl_Position = proj * view * vec4(aPos, 0.0, 1.0);
+}
@@ -0,0 +1,32 @@
+#version 400
+layout(location = 0) in uvec2 aTilePos;  // x, y in tiles
+layout(location = 1) in uvec2 aTileData; // layer, flags (bit 0 hides the tile, see TileInstanceHidden)
+layout(location = 2) in uint aTile;      // index into the tile sheet
+
+out vec2 UV;
+
+uniform mat4 proj;
+uniform mat4 view;
+uniform mat4 model;
+
+uniform int tileSize;
+uniform int sheetColumns;
+uniform int sheetRows;
+
+// animation frames of every tile (see TileAnimationTexture) and the frame currently shown
+uniform usampler2D animLookup;
+uniform int animFrame;
+
+void main() {
+    // unit quad corner, drawn as a 4 vertex triangle strip
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    // hidden instances are padding, collapsing the quad to a point keeps them from being rasterized
+    if ((aTileData.y & 1u) != 0u) corner = vec2(0.0);
+
+    uint tile = texelFetch(animLookup, ivec2(aTile, 0), 0)[animFrame];
+    vec2 cell = vec2(tile % uint(sheetColumns), tile / uint(sheetColumns));
+    UV = (cell + corner) / vec2(sheetColumns, sheetRows);
+
+    vec2 position = (vec2(aTilePos) + corner) * float(tileSize);
+    gl_Position = proj * view * model * vec4(position, float(aTileData.x), 1.0);
+}
@@ -0,0 +1,22 @@
+#version 400
+layout(location = 0) in vec2 aPos;       // x, y in tiles
+layout(location = 1) in uvec2 aTileData; // layer, corner (bit 0 right, bit 1 bottom)
+layout(location = 2) in uint aTile;      // index into the tile sheet
+
+out vec2 UV;
+
+uniform mat4 proj;
+uniform mat4 view;
+uniform mat4 model;
+
+uniform int tileSize;
+uniform int sheetColumns;
+uniform int sheetRows;
+
+void main() {
+    vec2 corner = vec2(aTileData.y & 1u, aTileData.y >> 1);
+    vec2 cell = vec2(aTile % uint(sheetColumns), aTile / uint(sheetColumns));
+    UV = (cell + corner) / vec2(sheetColumns, sheetRows);
+
+    gl_Position = proj * view * model * vec4(aPos * float(tileSize), float(aTileData.x), 1.0);
+}
@@ -1,19 +1,29 @@
 #include "event.h"
 #include "spdlog/spdlog.h"
 
-void EventDispatcher::Subscribe(const EventFn &callback) {
-  observers.push_back(callback);
+EventDispatcher::EventDispatcher() : asyncEvents(asyncCapacity) { }
+
+size_t EventDispatcher::nextTypeIndex() {
+  static size_t typeCount = 0;
+  return typeCount++;
 }
-void EventDispatcher::Post(const Event &event) const {
+
+void EventDispatcher::logEvent(const char* name, uint8_t signature) {
   // log only application level events
-  if ((event.signature & EVENT_APPLICATION) == EVENT_APPLICATION) {
-    spdlog::info("Event: {}", event.ToString());
+  if ((signature & EVENT_APPLICATION) == EVENT_APPLICATION) {
+    spdlog::info("Event: {}", name);
   }
+}
+
+void EventDispatcher::Flush() {
+  // At most one queue's worth, so producers that keep posting can't hold up the frame
+  AsyncEvent async;
+  for (size_t i = 0; i < asyncCapacity && asyncEvents.TryPop(async); i++) async.post(*this, async.data);
 
-  for (const auto& observer : observers) {
-    observer(event);
+  for (size_t i = 0; i < channels.size(); i++) {
+    if (channels[i]) channels[i]->Flush();
   }
 }
 
 /// Global event handler
-EventDispatcher gEventHandler;
\ No newline at end of file
+EventDispatcher gEventHandler;
@@ -1,9 +1,14 @@
 #ifndef KINGDOM_EVENT_H
 #define KINGDOM_EVENT_H
 
-#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
 #include <vector>
 #include "SDL2/SDL_scancode.h"
+#include "mpsc_queue.h"
 
 enum class EventType {
   ApplicationClose,
@@ -16,55 +21,165 @@ enum class EventType {
 const uint8_t EVENT_APPLICATION = 0b00000010;
 const uint8_t EVENT_OTHER       = 0b00000001;
 
-struct Event {
-  EventType type;
-  uint8_t signature = 0x00;
+// Events are plain values. Every event type names itself, sets its signature (application events are logged) and
+// whether a new event may replace the one still queued, for events where only the latest matters.
+struct ApplicationCloseEvent {
+  static constexpr const char* name = "ApplicationClose";
+  static constexpr uint8_t signature = EVENT_APPLICATION;
+  static constexpr bool coalesce = false;
+};
+struct MouseMoveEvent {
+  static constexpr const char* name = "MouseMove";
+  static constexpr uint8_t signature = EVENT_OTHER;
+  static constexpr bool coalesce = true; // subscribers only see the last position of a frame
 
-  explicit Event(EventType type, uint8_t sig)
-      : type(type), signature(sig) { }
-  virtual const char* ToString() const = 0;
+  int x, y;
 };
-struct ApplicationCloseEvent : Event {
-  ApplicationCloseEvent()
-      : Event(EventType::ApplicationClose, EVENT_APPLICATION) { }
+struct KeyboardEvent {
+  static constexpr const char* name = "KeyboardEvent";
+  static constexpr uint8_t signature = EVENT_OTHER;
+  static constexpr bool coalesce = false;
 
-  const char* ToString() const override {
-    return "ApplicationClose";
-  }
+  EventType type; // KeyboardButtonUp or KeyboardButtonDown
+  SDL_Scancode key;
 };
-struct MouseMoveEvent : Event {
-  int x, y;
 
-  MouseMoveEvent(int x, int y)
-      : Event(EventType::MouseMove, EVENT_OTHER),
-        x(x), y(y) { }
+// Typed event bus. Post copies the event into a ring buffer of its type, Flush (once per frame) hands every queued
+// event to the subscribers of its type. Nothing is allocated per event, the buffers only grow when a frame queues
+// more events of a type than any frame before. Events keep their order within a type, types are flushed in the
+// order they were first used. Subscribe, Post and Flush belong to the main thread, other threads use PostAsync.
+class EventDispatcher {
+  struct Channel {
+    virtual ~Channel() = default;
+    virtual void Flush() = 0;
+  };
+
+  template <typename E>
+  class Queue : public Channel {
+    // Either a free function or call(instance, event), function pointers don't round trip through void*
+    struct Subscriber {
+      void (*function)(const E& event);
+      void (*call)(void* instance, const E& event);
+      void* instance;
+    };
+
+    std::vector<Subscriber> subscribers;
+    std::vector<E> ring; // power of two size
+    size_t head = 0;
+    size_t count = 0;
+
+  public:
+    void Subscribe(void (*function)(const E&)) {
+      subscribers.push_back({ function, nullptr, nullptr });
+    }
+    void Subscribe(void (*call)(void*, const E&), void* instance) {
+      subscribers.push_back({ nullptr, call, instance });
+    }
+
+    void Push(const E& event) {
+      if (E::coalesce && count > 0) {
+        ring[(head + count - 1) & (ring.size() - 1)] = event;
+        return;
+      }
+
+      if (count == ring.size()) {
+        // Unroll into a buffer twice the size
+        std::vector<E> grown(ring.empty() ? 64 : ring.size() * 2);
+        for (size_t i = 0; i < count; i++) grown[i] = ring[(head + i) & (ring.size() - 1)];
+        ring.swap(grown);
+        head = 0;
+      }
+      ring[(head + count) & (ring.size() - 1)] = event;
+      count++;
+    }
+
+    void Flush() override {
+      // Events posted by subscribers wait for the next flush
+      for (size_t remaining = count; remaining > 0; remaining--) {
+        const E event = ring[head];
+        head = (head + 1) & (ring.size() - 1);
+        count--;
+
+        logEvent(E::name, E::signature);
+        for (size_t i = 0, n = subscribers.size(); i < n; i++) {
+          const Subscriber subscriber = subscribers[i];
+          if (subscriber.function) subscriber.function(event);
+          else subscriber.call(subscriber.instance, event);
+        }
+      }
+    }
+  };
+
+  std::vector<std::unique_ptr<Channel>> channels;
+
+  // Event posted from another thread, stored as bytes until Flush posts it on the main thread
+  static const size_t asyncEventSize = 48;
+  struct AsyncEvent {
+    void (*post)(EventDispatcher& dispatcher, const void* event);
+    alignas(std::max_align_t) unsigned char data[asyncEventSize];
+  };
+  MpscQueue<AsyncEvent> asyncEvents;
+
+  static size_t nextTypeIndex();
+  static void logEvent(const char* name, uint8_t signature);
+
+  template <typename E>
+  static size_t typeIndex() {
+    static const size_t index = nextTypeIndex();
+    return index;
+  }
 
-  const char* ToString() const override {
-    return "MouseMove";
+  template <typename E>
+  Queue<E>& queue() {
+    const size_t index = typeIndex<E>();
+    if (index >= channels.size()) channels.resize(index + 1);
+    if (!channels[index]) channels[index] = std::make_unique<Queue<E>>();
+    return static_cast<Queue<E>&>(*channels[index]);
   }
-};
-struct KeyboardEvent : Event {
-  SDL_Scancode key;
 
-  KeyboardEvent(EventType eventType, SDL_Scancode key)
-      : Event(eventType, EVENT_OTHER),
-        key(key) { }
+public:
+  static const size_t asyncCapacity = 4096;
+
+  EventDispatcher();
 
-  const char* ToString() const override {
-    return "KeyboardEvent";
+  /// Calls callback for every flushed event of type E
+  template <typename E>
+  void Subscribe(void (*callback)(const E&)) {
+    queue<E>().Subscribe(callback);
   }
-};
 
-// auto const& mouse = dynamic_cast<const MouseMoveEvent&>(event);
+  /// Calls (instance.*Method)(event) for every flushed event of type E, e.g. Subscribe<MouseMoveEvent, &Camera::OnMouseMove>(camera)
+  template <typename E, auto Method, typename T>
+  void Subscribe(T& instance) {
+    queue<E>().Subscribe([](void* instance, const E& event) {
+      (static_cast<T*>(instance)->*Method)(event);
+    }, &instance);
+  }
 
-typedef std::function<void(const Event&)> EventFn;
+  template <typename E>
+  void Post(const E& event) {
+    queue<E>().Push(event);
+  }
 
-class EventDispatcher {
-  std::vector<EventFn> observers;
+  /// Thread safe Post, the event is queued with the others at the start of the next Flush. Returns false and drops
+  /// the event when asyncCapacity events are already waiting.
+  template <typename E>
+  bool PostAsync(const E& event) {
+    static_assert(sizeof(E) <= asyncEventSize && alignof(E) <= alignof(std::max_align_t), "event too large for PostAsync");
+    static_assert(std::is_trivially_copyable<E>::value, "PostAsync events are copied as bytes");
+
+    AsyncEvent async;
+    async.post = [](EventDispatcher& dispatcher, const void* data) {
+      E event;
+      std::memcpy(&event, data, sizeof(E));
+      dispatcher.Post(event);
+    };
+    std::memcpy(async.data, &event, sizeof(E));
+    return asyncEvents.TryPush(async);
+  }
 
-public:
-  void Subscribe(const EventFn& callback);
-  void Post(const Event& event) const;
+  /// Dispatches everything posted since the last flush, async events first
+  void Flush();
 };
 
 extern EventDispatcher gEventHandler;
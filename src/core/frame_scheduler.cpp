@@ -0,0 +1,54 @@
+#include "frame_scheduler.h"
+#include <thread>
+
+FrameScheduler::FrameScheduler(float fixedStep, int maxSteps, float frameRateLimit)
+  : fixedStep(fixedStep), maxSteps(maxSteps > 0 ? maxSteps : 1),
+    minFrameTime(frameRateLimit > 0.f ? 1.0 / frameRateLimit : 0.0),
+    frameStart(Clock::now()), accumulator(0.0), stepCount(0), droppedSteps(0) { }
+
+int FrameScheduler::BeginFrame() {
+  const auto now = Clock::now();
+  accumulator += std::chrono::duration<double>(now - frameStart).count();
+  frameStart = now;
+
+  int steps = int(accumulator / fixedStep);
+  if (steps > maxSteps) {
+    droppedSteps += uint64_t(steps - maxSteps);
+    steps = maxSteps;
+    accumulator -= double(steps) * fixedStep;
+    // Keep the partial step so alpha stays continuous, drop the rest
+    accumulator -= double(int(accumulator / fixedStep)) * fixedStep;
+  } else {
+    accumulator -= double(steps) * fixedStep;
+  }
+
+  stepCount += uint64_t(steps);
+  return steps;
+}
+
+void FrameScheduler::EndFrame() {
+  if (minFrameTime <= 0.0) return;
+
+  // Sleep through most of the remaining time, the scheduler may oversleep by a millisecond or so, then yield
+  // until the deadline
+  const auto deadline = frameStart + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(minFrameTime));
+  const auto margin = std::chrono::milliseconds(1);
+  if (deadline - Clock::now() > margin) std::this_thread::sleep_until(deadline - margin);
+  while (Clock::now() < deadline) std::this_thread::yield();
+}
+
+float FrameScheduler::FixedStep() const {
+  return float(fixedStep);
+}
+
+float FrameScheduler::Alpha() const {
+  return float(accumulator / fixedStep);
+}
+
+uint64_t FrameScheduler::StepCount() const {
+  return stepCount;
+}
+
+uint64_t FrameScheduler::DroppedSteps() const {
+  return droppedSteps;
+}
@@ -0,0 +1,46 @@
+#ifndef KINGDOM_FRAME_SCHEDULER_H
+#define KINGDOM_FRAME_SCHEDULER_H
+
+#include <chrono>
+#include <cstdint>
+
+// Fixed timestep frame loop timing. Every frame BeginFrame returns how many fixed simulation steps are due, at most
+// maxSteps, so a slow frame is caught up on the next one instead of slowing the simulation down. Time beyond the cap
+// is dropped to keep a stall (debugger, window drag) from snowballing into ever longer frames.
+//
+//   const int steps = scheduler.BeginFrame();
+//   for (int i = 0; i < steps; i++) update(scheduler.FixedStep());
+//   render(scheduler.Alpha());
+//   scheduler.EndFrame();
+class FrameScheduler {
+  using Clock = std::chrono::steady_clock;
+
+  double fixedStep;
+  int maxSteps;
+  double minFrameTime; // 0 leaves frames unpaced
+
+  Clock::time_point frameStart;
+  double accumulator;
+  uint64_t stepCount;
+  uint64_t droppedSteps;
+
+public:
+  /// fixedStep in seconds, frameRateLimit <= 0 renders as fast as possible
+  explicit FrameScheduler(float fixedStep, int maxSteps = 8, float frameRateLimit = 0.f);
+
+  /// Measures the time since the last frame and returns the number of fixed steps to run this frame
+  int BeginFrame();
+  /// Sleeps until the frame rate limit allows the next frame
+  void EndFrame();
+
+  float FixedStep() const;
+  /// How far the simulation is between the last step and the next one, in [0, 1). Render state interpolated by alpha
+  /// between the previous and current step lags one step behind but moves smoothly at any frame rate.
+  float Alpha() const;
+
+  uint64_t StepCount() const;
+  /// Steps skipped by the maxSteps cap since the start
+  uint64_t DroppedSteps() const;
+};
+
+#endif //KINGDOM_FRAME_SCHEDULER_H
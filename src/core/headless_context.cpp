@@ -0,0 +1,132 @@
+#include "headless_context.h"
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cstring>
+#include "glad/glad.h"
+#include "spdlog/spdlog.h"
+
+namespace {
+  // Prefers Mesa's surfaceless platform, which needs neither a display server nor a GPU
+  EGLDisplay openDisplay() {
+    const auto getPlatformDisplay =
+        reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+    if (getPlatformDisplay) {
+      EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+      if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr)) return display;
+    }
+
+    EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (display != EGL_NO_DISPLAY && eglInitialize(display, nullptr, nullptr)) return display;
+    return EGL_NO_DISPLAY;
+  }
+}
+
+HeadlessContext::HeadlessContext(int width, int height)
+  : display(nullptr), context(nullptr), framebuffer(0), colorBuffer(0), width(width), height(height)
+{
+  spdlog::info("Initializing headless OpenGL (Core Profile, v4.0), framebuffer ({}, {})", width, height);
+
+  EGLDisplay eglDisplay = openDisplay();
+  if (eglDisplay == EGL_NO_DISPLAY) {
+    spdlog::error("No EGL display available (error 0x{:x})", eglGetError());
+    return;
+  }
+  display = eglDisplay;
+
+  if (!eglBindAPI(EGL_OPENGL_API)) {
+    spdlog::error("EGL display does not support desktop OpenGL");
+    return;
+  }
+
+  // Nothing is drawn to EGL surfaces, any config that can render OpenGL will do
+  const EGLint configAttributes[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+  EGLConfig config = nullptr;
+  EGLint configCount = 0;
+  eglChooseConfig(eglDisplay, configAttributes, &config, 1, &configCount);
+
+  const EGLint contextAttributes[] = {
+      EGL_CONTEXT_MAJOR_VERSION, 4,
+      EGL_CONTEXT_MINOR_VERSION, 0,
+      EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+      EGL_NONE
+  };
+  EGLContext eglContext = eglCreateContext(eglDisplay, configCount > 0 ? config : nullptr, EGL_NO_CONTEXT, contextAttributes);
+  if (eglContext == EGL_NO_CONTEXT) {
+    spdlog::error("Failed to create an OpenGL 4.0 core context (error 0x{:x})", eglGetError());
+    return;
+  }
+  context = eglContext;
+
+  if (!eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext) ||
+      !gladLoadGLLoader(reinterpret_cast<GLADloadproc>(eglGetProcAddress))) {
+    spdlog::error("Failed to make the headless context current");
+    eglDestroyContext(eglDisplay, eglContext);
+    context = nullptr;
+    return;
+  }
+
+  spdlog::info("VENDOR: {}", glGetString(GL_VENDOR));
+  spdlog::info("RENDERER: {}", glGetString(GL_RENDERER));
+
+  glGenRenderbuffers(1, &colorBuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+  glGenFramebuffers(1, &framebuffer);
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    spdlog::error("Headless framebuffer is incomplete");
+  }
+
+  // Same state GameWindow sets up, so frames match the game's
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  glClearColor(0.f, 0.f, 0.f, 1.f);
+  Bind();
+}
+HeadlessContext::~HeadlessContext() {
+  if (context) {
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteRenderbuffers(1, &colorBuffer);
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(display, context);
+  }
+  if (display) eglTerminate(display);
+}
+
+bool HeadlessContext::IsValid() const {
+  return context != nullptr;
+}
+
+int HeadlessContext::Width() const {
+  return width;
+}
+
+int HeadlessContext::Height() const {
+  return height;
+}
+
+void HeadlessContext::Bind() const {
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glViewport(0, 0, width, height);
+}
+
+std::vector<uint8_t> HeadlessContext::ReadPixels() const {
+  std::vector<uint8_t> pixels(size_t(width) * height * 4);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+  glPixelStorei(GL_PACK_ALIGNMENT, 1);
+  glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+
+  // GL returns the bottom row first
+  const size_t rowSize = size_t(width) * 4;
+  std::vector<uint8_t> row(rowSize);
+  for (int y = 0; y < height / 2; y++) {
+    uint8_t* top = pixels.data() + size_t(y) * rowSize;
+    uint8_t* bottom = pixels.data() + size_t(height - 1 - y) * rowSize;
+    std::memcpy(row.data(), top, rowSize);
+    std::memcpy(top, bottom, rowSize);
+    std::memcpy(bottom, row.data(), rowSize);
+  }
+  return pixels;
+}
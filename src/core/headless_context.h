@@ -0,0 +1,35 @@
+#ifndef KINGDOM_HEADLESS_CONTEXT_H
+#define KINGDOM_HEADLESS_CONTEXT_H
+
+#include <cstdint>
+#include <vector>
+
+// OpenGL 4.0 core context without a window, for benchmarks and image comparisons. Uses an EGL surfaceless display
+// (Mesa llvmpipe works) and renders into an RGBA8 framebuffer object instead of a back buffer.
+class HeadlessContext {
+  void* display;
+  void* context;
+  uint32_t framebuffer;
+  uint32_t colorBuffer;
+  int width;
+  int height;
+
+public:
+  HeadlessContext(int width, int height);
+  ~HeadlessContext();
+
+  HeadlessContext(const HeadlessContext&) = delete;
+  HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+  /// False when no context could be created, the reason is logged
+  bool IsValid() const;
+  int Width() const;
+  int Height() const;
+
+  /// Binds the framebuffer and sets the viewport to cover it
+  void Bind() const;
+  /// Waits for rendering to finish and returns the framebuffer as RGBA8 rows, top row first
+  std::vector<uint8_t> ReadPixels() const;
+};
+
+#endif //KINGDOM_HEADLESS_CONTEXT_H
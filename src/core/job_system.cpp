@@ -0,0 +1,247 @@
+#include "job_system.h"
+#include <cstdint>
+#include <cstring>
+
+namespace {
+  // Per thread, power of two
+  const int64_t dequeCapacity = 4096;
+  const size_t jobPoolSize = 4096;
+
+  // Rounds through a worker looks for work before going to sleep
+  const int idleSpins = 64;
+
+  // Jobs are recycled round robin, a slot is reused once its previous job has run. Every thread that starts jobs
+  // has its own pool, so allocation never contends.
+  struct JobPool {
+    std::unique_ptr<JobSystem::Job[]> jobs;
+    size_t next;
+
+    JobPool() : jobs(new JobSystem::Job[jobPoolSize]), next(0) {
+      for (size_t i = 0; i < jobPoolSize; i++) jobs[i].busy.store(false, std::memory_order_relaxed);
+    }
+  };
+
+  thread_local const JobSystem* localSystem = nullptr;
+  thread_local void* localWorkerSlot = nullptr;
+  thread_local uint32_t stealSeed = 0x9e3779b9u;
+
+  JobPool& jobPool() {
+    thread_local JobPool pool;
+    return pool;
+  }
+
+  uint32_t nextRandom() {
+    stealSeed ^= stealSeed << 13;
+    stealSeed ^= stealSeed >> 17;
+    stealSeed ^= stealSeed << 5;
+    return stealSeed;
+  }
+}
+
+// Chase-Lev deque. The owner pushes and pops at bottom, thieves take from top, the last remaining job is decided
+// by a compare-exchange on top.
+struct JobSystem::Worker {
+  std::atomic<int64_t> top;
+  std::atomic<int64_t> bottom;
+  std::unique_ptr<std::atomic<Job*>[]> buffer;
+
+  Worker() : top(0), bottom(0), buffer(new std::atomic<Job*>[dequeCapacity]) {
+    for (int64_t i = 0; i < dequeCapacity; i++) buffer[i].store(nullptr, std::memory_order_relaxed);
+  }
+
+  bool Push(Job* job) {
+    const int64_t b = bottom.load(std::memory_order_relaxed);
+    const int64_t t = top.load(std::memory_order_acquire);
+    if (b - t >= dequeCapacity) return false;
+
+    buffer[b & (dequeCapacity - 1)].store(job, std::memory_order_relaxed);
+    bottom.store(b + 1, std::memory_order_release);
+    return true;
+  }
+
+  Job* Pop() {
+    const int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_seq_cst);
+    int64_t t = top.load(std::memory_order_seq_cst);
+
+    if (t > b) {
+      bottom.store(b + 1, std::memory_order_relaxed);
+      return nullptr;
+    }
+
+    Job* job = buffer[b & (dequeCapacity - 1)].load(std::memory_order_relaxed);
+    if (t == b) {
+      // Last job, race the thieves for it
+      if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) job = nullptr;
+      bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return job;
+  }
+
+  Job* Steal() {
+    int64_t t = top.load(std::memory_order_seq_cst);
+    const int64_t b = bottom.load(std::memory_order_seq_cst);
+    if (t >= b) return nullptr;
+
+    Job* job = buffer[t & (dequeCapacity - 1)].load(std::memory_order_relaxed);
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) return nullptr;
+    return job;
+  }
+};
+
+JobSystem::JobSystem(int threadCount)
+  : owner(std::this_thread::get_id()), queuedJobs(0), sleepingWorkers(0), stopping(false)
+{
+  threadCount = ResolveThreadCount(threadCount);
+  for (int i = 0; i < threadCount; i++) workers.push_back(std::make_unique<Worker>());
+
+  threads.reserve(size_t(threadCount - 1));
+  for (int i = 1; i < threadCount; i++) {
+    threads.emplace_back(&JobSystem::workerLoop, this, workers[i].get());
+  }
+}
+
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    stopping.store(true);
+  }
+  wakeUp.notify_all();
+  for (auto& thread : threads) thread.join();
+}
+
+int JobSystem::ThreadCount() const {
+  return int(workers.size());
+}
+
+JobSystem::Worker* JobSystem::localWorker() const {
+  if (localSystem == this) return static_cast<Worker*>(localWorkerSlot);
+  if (std::this_thread::get_id() == owner) return workers[0].get();
+  return nullptr;
+}
+
+JobSystem::Job* JobSystem::allocate() {
+  JobPool& pool = jobPool();
+
+  // The next slot is still queued when more than jobPoolSize jobs are waiting to run, help until it frees up
+  Job* job = &pool.jobs[pool.next++ & (jobPoolSize - 1)];
+  while (job->busy.load(std::memory_order_acquire)) {
+    if (!runOne()) std::this_thread::yield();
+  }
+
+  job->busy.store(true, std::memory_order_relaxed);
+  return job;
+}
+
+void JobSystem::submit(Job* job) {
+  Worker* worker = localWorker();
+  if (worker) {
+    // A full deque runs the job right away
+    if (!worker->Push(job)) {
+      execute(job);
+      return;
+    }
+  } else {
+    std::lock_guard<std::mutex> lock(externalMutex);
+    externalJobs.push_back(job);
+  }
+
+  queuedJobs.fetch_add(1, std::memory_order_seq_cst);
+  if (sleepingWorkers.load(std::memory_order_seq_cst) > 0) {
+    // Taking the lock orders this with a worker that is about to sleep, so the wake up can't be lost
+    { std::lock_guard<std::mutex> lock(sleepMutex); }
+    wakeUp.notify_one();
+  }
+}
+
+JobSystem::Job* JobSystem::takeJob(Worker* worker) {
+  if (worker) {
+    if (Job* job = worker->Pop()) return job;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(externalMutex);
+    if (!externalJobs.empty()) {
+      Job* job = externalJobs.back();
+      externalJobs.pop_back();
+      return job;
+    }
+  }
+
+  // Start at a random victim so thieves spread out
+  const size_t count = workers.size();
+  const size_t start = nextRandom() % count;
+  for (size_t i = 0; i < count; i++) {
+    Worker* victim = workers[(start + i) % count].get();
+    if (victim == worker) continue;
+    if (Job* job = victim->Steal()) return job;
+  }
+  return nullptr;
+}
+
+bool JobSystem::runOne() {
+  if (queuedJobs.load(std::memory_order_relaxed) == 0) return false;
+
+  Job* job = takeJob(localWorker());
+  if (!job) return false;
+
+  queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+  execute(job);
+  return true;
+}
+
+void JobSystem::execute(Job* job) {
+  // Run a copy and release the slot first, a slot held by a running job could otherwise be needed by one of the
+  // jobs it starts and never come free
+  alignas(std::max_align_t) unsigned char data[jobDataSize];
+  std::memcpy(data, job->data, jobDataSize);
+  const auto invoke = job->invoke;
+  JobCounter* counter = job->counter;
+  job->busy.store(false, std::memory_order_release);
+
+  invoke(data);
+  counter->pending.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+void JobSystem::Wait(const JobCounter& counter) {
+  while (!counter.Done()) {
+    if (!runOne()) std::this_thread::yield();
+  }
+}
+
+void JobSystem::workerLoop(Worker* worker) {
+  localSystem = this;
+  localWorkerSlot = worker;
+  stealSeed ^= uint32_t(reinterpret_cast<uintptr_t>(worker));
+
+  int idle = 0;
+  while (!stopping.load(std::memory_order_relaxed)) {
+    if (runOne()) {
+      idle = 0;
+      continue;
+    }
+    if (++idle < idleSpins) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    sleepingWorkers.fetch_add(1, std::memory_order_seq_cst);
+    wakeUp.wait(lock, [this]() { return stopping.load() || queuedJobs.load(std::memory_order_seq_cst) > 0; });
+    sleepingWorkers.fetch_sub(1, std::memory_order_relaxed);
+    idle = 0;
+  }
+
+  localSystem = nullptr;
+  localWorkerSlot = nullptr;
+}
+
+int ResolveThreadCount(int threadCount) {
+  if (threadCount <= 0) threadCount = int(std::thread::hardware_concurrency());
+  return std::max(threadCount, 1);
+}
+
+JobSystem& GlobalJobSystem() {
+  static JobSystem system(0);
+  return system;
+}
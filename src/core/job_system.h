@@ -0,0 +1,135 @@
+#ifndef KINGDOM_JOB_SYSTEM_H
+#define KINGDOM_JOB_SYSTEM_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Counts the unfinished jobs started with it. A running job may start children on its own counter, the counter
+// then only reaches zero once the job and all of its descendants have finished.
+class JobCounter {
+  friend class JobSystem;
+  std::atomic<int> pending;
+
+public:
+  JobCounter() : pending(0) { }
+
+  JobCounter(const JobCounter&) = delete;
+  JobCounter& operator=(const JobCounter&) = delete;
+
+  bool Done() const {
+    return pending.load(std::memory_order_acquire) == 0;
+  }
+};
+
+// Work-stealing thread pool. Every worker owns a deque it pushes and pops jobs at the bottom of, idle workers steal
+// from the top of the others'. The thread that creates the system owns a deque too and works through jobs while it
+// waits, so a system of n threads starts n - 1 workers. Other threads may start jobs as well, those go through a
+// shared queue.
+//
+// Jobs are stored inline without allocating, the callable has to be trivially copyable and fit into jobDataSize
+// bytes, which covers lambdas capturing a few references.
+class JobSystem {
+public:
+  static const size_t jobDataSize = 48;
+
+  struct Job {
+    void (*invoke)(const void* data);
+    JobCounter* counter;
+    std::atomic<bool> busy; // queued, the slot is released when the job starts running
+    alignas(std::max_align_t) unsigned char data[jobDataSize];
+  };
+
+private:
+  struct Worker;
+
+  std::vector<std::unique_ptr<Worker>> workers; // workers[0] belongs to the owning thread
+  std::vector<std::thread> threads;
+  std::thread::id owner;
+
+  // Jobs started from threads that don't own a deque
+  std::mutex externalMutex;
+  std::vector<Job*> externalJobs;
+
+  // Idle workers sleep until queuedJobs is non zero
+  std::atomic<int> queuedJobs;
+  std::atomic<int> sleepingWorkers;
+  std::atomic<bool> stopping;
+  std::mutex sleepMutex;
+  std::condition_variable wakeUp;
+
+  Worker* localWorker() const;
+  Job* allocate();
+  void submit(Job* job);
+  Job* takeJob(Worker* worker);
+  bool runOne();
+  void execute(Job* job);
+  void workerLoop(Worker* worker);
+
+  template <typename Fn>
+  void splitRange(JobCounter& counter, int first, int last, int grain, const Fn& fn) {
+    // Hand the upper half to another job until the range fits the grain, so idle workers steal the big halves first
+    while (last - first > grain) {
+      const int middle = first + (last - first) / 2;
+      Run(counter, [this, &counter, middle, last, grain, &fn]() { splitRange(counter, middle, last, grain, fn); });
+      last = middle;
+    }
+    fn(first, last);
+  }
+
+public:
+  /// threadCount <= 0 uses every hardware thread, the calling thread counts as one of them
+  explicit JobSystem(int threadCount = 0);
+  ~JobSystem();
+
+  JobSystem(const JobSystem&) = delete;
+  JobSystem& operator=(const JobSystem&) = delete;
+
+  int ThreadCount() const;
+
+  /// Starts fn() on the pool, counted by counter
+  template <typename Fn>
+  void Run(JobCounter& counter, const Fn& fn) {
+    static_assert(sizeof(Fn) <= jobDataSize, "job callable too large, capture by reference instead");
+    static_assert(alignof(Fn) <= alignof(std::max_align_t), "job callable is over-aligned");
+    static_assert(std::is_trivially_copyable<Fn>::value && std::is_trivially_destructible<Fn>::value,
+                  "job callables are copied as bytes and never destroyed");
+
+    Job* job = allocate();
+    job->invoke = [](const void* data) { (*std::launder(reinterpret_cast<const Fn*>(data)))(); };
+    job->counter = &counter;
+    new (job->data) Fn(fn);
+
+    counter.pending.fetch_add(1, std::memory_order_relaxed);
+    submit(job);
+  }
+
+  /// Runs other jobs until every job of counter has finished
+  void Wait(const JobCounter& counter);
+
+  /// Calls fn(first, last) over sub-ranges of [begin, end) no longer than grain, returns once all of them are done
+  template <typename Fn>
+  void ParallelFor(int begin, int end, int grain, const Fn& fn) {
+    if (end <= begin) return;
+
+    JobCounter counter;
+    splitRange(counter, begin, end, std::max(grain, 1), fn);
+    Wait(counter);
+  }
+};
+
+/// threadCount <= 0 uses every hardware thread
+int ResolveThreadCount(int threadCount);
+
+/// Pool shared by worldgen, meshing and the rest of the engine, created with every hardware thread on first use.
+/// The thread that first calls it becomes the owning thread.
+JobSystem& GlobalJobSystem();
+
+#endif //KINGDOM_JOB_SYSTEM_H
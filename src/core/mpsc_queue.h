@@ -0,0 +1,80 @@
+#ifndef KINGDOM_MPSC_QUEUE_H
+#define KINGDOM_MPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+// Bounded lock-free queue for many producer threads and one consumer thread. Every cell carries a sequence number
+// that says whose turn it is: producers claim a cell by advancing the enqueue position and publish it by bumping
+// the sequence, the consumer hands the cell back to the producers one lap later. Neither side ever blocks, TryPush
+// fails when the queue is full and TryPop when it is empty.
+template <typename T>
+class MpscQueue {
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T value;
+  };
+
+  std::unique_ptr<Cell[]> cells;
+  size_t mask;
+
+  // Separate cache lines, producers hammer enqueuePos while the consumer owns dequeuePos
+  alignas(64) std::atomic<size_t> enqueuePos;
+  alignas(64) size_t dequeuePos;
+
+public:
+  /// capacity is rounded up to a power of two
+  explicit MpscQueue(size_t capacity) : enqueuePos(0), dequeuePos(0) {
+    size_t size = 2;
+    while (size < capacity) size *= 2;
+
+    cells.reset(new Cell[size]);
+    mask = size - 1;
+    for (size_t i = 0; i < size; i++) cells[i].sequence.store(i, std::memory_order_relaxed);
+  }
+
+  MpscQueue(const MpscQueue&) = delete;
+  MpscQueue& operator=(const MpscQueue&) = delete;
+
+  size_t Capacity() const {
+    return mask + 1;
+  }
+
+  /// Any thread, returns false when the queue is full
+  bool TryPush(const T& value) {
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    Cell* cell;
+    while (true) {
+      cell = &cells[pos & mask];
+      const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+      const auto lap = static_cast<ptrdiff_t>(sequence - pos);
+
+      if (lap == 0) {
+        if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+      } else if (lap < 0) {
+        return false; // the consumer hasn't freed this cell yet
+      } else {
+        pos = enqueuePos.load(std::memory_order_relaxed); // another producer took it
+      }
+    }
+
+    cell->value = value;
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// Consumer thread only, returns false when the queue is empty
+  bool TryPop(T& value) {
+    Cell* cell = &cells[dequeuePos & mask];
+    const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+    if (static_cast<ptrdiff_t>(sequence - (dequeuePos + 1)) < 0) return false;
+
+    value = cell->value;
+    cell->sequence.store(dequeuePos + mask + 1, std::memory_order_release);
+    dequeuePos++;
+    return true;
+  }
+};
+
+#endif //KINGDOM_MPSC_QUEUE_H
@@ -0,0 +1,23 @@
+#ifndef KINGDOM_TILE_INSTANCE_H
+#define KINGDOM_TILE_INSTANCE_H
+
+#include <cstdint>
+
+// Per-tile data of the instanced tile map and the building pass, the quad corners and UVs are derived in
+// tileInstancedVS.glsl. Plain data without GL state, so the simulation can produce it for the renderer.
+struct TileInstance {
+  uint16_t x, y;
+  uint8_t layer;
+  uint8_t flags;
+  uint16_t tile;
+};
+static_assert(sizeof(TileInstance) == 8, "TileInstance is uploaded as tightly packed 8 byte records");
+
+// TileInstance flag of unused buffer slots, the shader collapses these to a point
+const uint8_t TileInstanceHidden = 1;
+
+inline TileInstance EncodeTileInstance(int x, int y, int layer, int tile, uint8_t flags = 0) {
+  return TileInstance{ uint16_t(x), uint16_t(y), uint8_t(layer), flags, uint16_t(tile) };
+}
+
+#endif //KINGDOM_TILE_INSTANCE_H
@@ -0,0 +1,48 @@
+#ifndef KINGDOM_TRIPLE_BUFFER_H
+#define KINGDOM_TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+// Hands values from one writer thread to one reader thread without locks. The writer fills Back and publishes it,
+// the reader picks up the latest published value with Acquire and reads it through Front. Neither side ever waits,
+// values published faster than the reader acquires them are skipped.
+//
+// Slots are reused, so Back holds a value published two rounds earlier and has to be brought up to date, not
+// assumed empty. Keeping containers in the slots lets them keep their capacity.
+template <typename T>
+class TripleBuffer {
+  static const uint8_t indexMask = 0b011;
+  static const uint8_t freshBit  = 0b100; // set when middle holds a value the reader hasn't seen
+
+  T slots[3];
+  std::atomic<uint8_t> middle;
+  uint8_t back;
+  uint8_t front;
+
+public:
+  TripleBuffer() : middle(1), back(0), front(2) { }
+
+  TripleBuffer(const TripleBuffer&) = delete;
+  TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+  /// Writer thread only
+  T& Back() {
+    return slots[back];
+  }
+  void Publish() {
+    back = middle.exchange(uint8_t(back | freshBit), std::memory_order_acq_rel) & indexMask;
+  }
+
+  /// Reader thread only, returns false when nothing was published since the last call and Front is unchanged
+  bool Acquire() {
+    if ((middle.load(std::memory_order_relaxed) & freshBit) == 0) return false;
+    front = middle.exchange(front, std::memory_order_acq_rel) & indexMask;
+    return true;
+  }
+  const T& Front() const {
+    return slots[front];
+  }
+};
+
+#endif //KINGDOM_TRIPLE_BUFFER_H
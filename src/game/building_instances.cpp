@@ -0,0 +1,73 @@
+#include "building_instances.h"
+#include "building_data.h"
+#include <algorithm>
+
+namespace {
+  const uint32_t noSlot = ~uint32_t(0);
+
+  size_t entityIndex(entt::entity entity) {
+    return size_t(entt::to_entity(entity));
+  }
+}
+
+BuildingInstances::BuildingInstances(entt::registry& registry) : registry(registry), version(0) {
+  // Pick up the buildings that already exist, the signals cover everything after this
+  for (auto entity : registry.view<BuildingData>()) onConstruct(registry, entity);
+
+  registry.on_construct<BuildingData>().connect<&BuildingInstances::onConstruct>(*this);
+  registry.on_update<BuildingData>().connect<&BuildingInstances::onUpdate>(*this);
+  registry.on_destroy<BuildingData>().connect<&BuildingInstances::onDestroy>(*this);
+}
+
+BuildingInstances::~BuildingInstances() {
+  registry.on_construct<BuildingData>().disconnect(this);
+  registry.on_update<BuildingData>().disconnect(this);
+  registry.on_destroy<BuildingData>().disconnect(this);
+}
+
+void BuildingInstances::onConstruct(entt::registry&, entt::entity entity) {
+  const size_t index = entityIndex(entity);
+  if (index >= slots.size()) slots.resize(std::max(index + 1, slots.size() * 2), noSlot);
+
+  const auto slot = uint32_t(instances.size());
+  slots[index] = slot;
+  instances.emplace_back();
+  instanceOwners.push_back(entity);
+  writeInstance(slot, entity);
+}
+
+void BuildingInstances::onUpdate(entt::registry&, entt::entity entity) {
+  writeInstance(slots[entityIndex(entity)], entity);
+}
+
+void BuildingInstances::onDestroy(entt::registry&, entt::entity entity) {
+  // Swap and pop, only the moved instance changes
+  const size_t index = entityIndex(entity);
+  const uint32_t slot = slots[index];
+  const auto last = uint32_t(instances.size() - 1);
+
+  if (slot != last) {
+    instances[slot] = instances[last];
+    instanceOwners[slot] = instanceOwners[last];
+    slots[entityIndex(instanceOwners[slot])] = slot;
+  }
+
+  instances.pop_back();
+  instanceOwners.pop_back();
+  slots[index] = noSlot;
+  version++;
+}
+
+void BuildingInstances::writeInstance(uint32_t slot, entt::entity entity) {
+  const auto& building = registry.get<BuildingData>(entity);
+  instances[slot] = EncodeTileInstance(building.x, building.y, 0, building.spriteID);
+  version++;
+}
+
+const std::vector<TileInstance>& BuildingInstances::Instances() const {
+  return instances;
+}
+
+uint64_t BuildingInstances::Version() const {
+  return version;
+}
@@ -0,0 +1,39 @@
+#ifndef KINGDOM_BUILDING_INSTANCES_H
+#define KINGDOM_BUILDING_INSTANCES_H
+
+#include <cstdint>
+#include <vector>
+#include "entt/entt.hpp"
+#include "../core/tile_instance.h"
+
+// Every BuildingData entity as a dense array of TileInstances, kept in sync through the registry's
+// construct/update/destroy signals. Has no GL state, so it can live on the simulation thread while
+// BuildingRenderer draws copies of the array.
+class BuildingInstances {
+  entt::registry& registry;
+
+  // instanceOwners[i] owns instances[i], slots maps an entity index back to its instance
+  std::vector<TileInstance> instances;
+  std::vector<entt::entity> instanceOwners;
+  std::vector<uint32_t> slots;
+  uint64_t version;
+
+  void onConstruct(entt::registry& registry, entt::entity entity);
+  void onUpdate(entt::registry& registry, entt::entity entity);
+  void onDestroy(entt::registry& registry, entt::entity entity);
+
+  void writeInstance(uint32_t slot, entt::entity entity);
+
+public:
+  explicit BuildingInstances(entt::registry& registry);
+  ~BuildingInstances();
+
+  BuildingInstances(const BuildingInstances&) = delete;
+  BuildingInstances& operator=(const BuildingInstances&) = delete;
+
+  const std::vector<TileInstance>& Instances() const;
+  /// Changes whenever Instances does
+  uint64_t Version() const;
+};
+
+#endif //KINGDOM_BUILDING_INSTANCES_H
@@ -0,0 +1,39 @@
+#include "minimap.h"
+#include "world_generator.h"
+
+std::vector<uint8_t> worldgen::GenerateMinimapPixels(const std::vector<uint8_t>& featuremap) {
+  std::vector<uint8_t> imageData(featuremap.size() * 4, 0);
+
+  size_t i = 0;
+  for (auto feature : featuremap) {
+    uint8_t* pixel = imageData.data() + i * 4;
+
+    if (feature == waterFeature) {
+      pixel[0] = 0;
+      pixel[1] = 0;
+      pixel[2] = 255;
+      pixel[3] = 255;
+    } else if ((feature & mountainFeature) == mountainFeature) {
+      pixel[0] = 255;
+      pixel[1] = 0;
+      pixel[2] = 0;
+      pixel[3] = 255;
+    } else if ((feature & landFeature) == landFeature) {
+      pixel[0] = 0;
+      pixel[1] = 255;
+      pixel[2] = 0;
+      pixel[3] = 255;
+    }
+
+    if ((feature & borderFlag) == borderFlag) {
+      pixel[0] = 255;
+      pixel[1] = 125;
+      pixel[2] = 125;
+      pixel[3] = 255;
+    }
+
+    i++;
+  }
+
+  return imageData;
+}
@@ -0,0 +1,12 @@
+#ifndef KINGDOM_MINIMAP_H
+#define KINGDOM_MINIMAP_H
+
+#include <cstdint>
+#include <vector>
+
+namespace worldgen {
+  /// RGBA8 pixels, one per tile: water is blue, land green, mountains red and borders pink
+  std::vector<uint8_t> GenerateMinimapPixels(const std::vector<uint8_t>& featuremap);
+}
+
+#endif //KINGDOM_MINIMAP_H
@@ -0,0 +1,58 @@
+#include "simulation.h"
+#include "building_data.h"
+
+namespace {
+  const float animFrameTime = 0.45f;
+}
+
+Simulation::Simulation(entt::registry& registry, int mapWidth, int mapHeight, float zoom)
+  : registry(registry), buildings(registry), mapWidth(mapWidth), mapHeight(mapHeight), zoom(zoom), commands(commandCapacity),
+    stepCount(0), prevCameraPos(0.f), cameraPos(0.f), cameraDrag(0.f), animTimer(0.f), animIndex(0) { }
+
+bool Simulation::Post(const SimulationCommand& command) {
+  return commands.TryPush(command);
+}
+
+void Simulation::apply(const SimulationCommand& command) {
+  switch (command.type) {
+    case SimulationCommand::Type::PlaceBuilding:
+      if (command.x < 0 || command.y < 0 || command.x >= mapWidth || command.y >= mapHeight) break;
+      registry.emplace<BuildingData>(registry.create(), 730, command.x, command.y);
+      break;
+    case SimulationCommand::Type::MoveCamera:
+      cameraDrag += command.offset;
+      break;
+  }
+}
+
+void Simulation::Step(float dt) {
+  // At most one queue's worth, commands posted while draining wait for the next step
+  SimulationCommand command;
+  for (size_t i = 0; i < commandCapacity && commands.TryPop(command); i++) apply(command);
+
+  // The drag is applied once per step, rendering interpolates between the two positions
+  prevCameraPos = cameraPos;
+  cameraPos += cameraDrag / zoom;
+  cameraDrag = glm::vec2(0.f);
+
+  animTimer += dt;
+  if (animTimer >= animFrameTime) {
+    animIndex = (animIndex == 3) ? 0 : animIndex + 1;
+    animTimer -= animFrameTime;
+  }
+
+  stepCount++;
+}
+
+void Simulation::WriteSnapshot(RenderSnapshot& snapshot) const {
+  snapshot.step = stepCount;
+  snapshot.time = std::chrono::steady_clock::now();
+  snapshot.prevCameraPos = prevCameraPos;
+  snapshot.cameraPos = cameraPos;
+  snapshot.animIndex = animIndex;
+
+  if (snapshot.buildingsVersion != buildings.Version()) {
+    snapshot.buildings = buildings.Instances();
+    snapshot.buildingsVersion = buildings.Version();
+  }
+}
@@ -0,0 +1,69 @@
+#ifndef KINGDOM_SIMULATION_H
+#define KINGDOM_SIMULATION_H
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include "entt/entt.hpp"
+#include "glm/glm.hpp"
+#include "building_instances.h"
+#include "../core/mpsc_queue.h"
+
+// Input forwarded from the window thread to the simulation
+struct SimulationCommand {
+  enum struct Type {
+    PlaceBuilding, // at tile (x, y)
+    MoveCamera     // by offset, in screen pixels
+  };
+
+  Type type;
+  int x, y;
+  glm::vec2 offset;
+};
+
+// Everything the renderer needs from one simulation step. Snapshots are handed over through a TripleBuffer and
+// reused, the buildings are only copied again when buildingsVersion changes.
+struct RenderSnapshot {
+  uint64_t step = 0;
+  std::chrono::steady_clock::time_point time; // when step finished, rendering interpolates from here
+  glm::vec2 prevCameraPos = glm::vec2(0.f);
+  glm::vec2 cameraPos = glm::vec2(0.f);
+  int animIndex = 0;
+
+  uint64_t buildingsVersion = ~uint64_t(0);
+  std::vector<TileInstance> buildings;
+};
+
+// Fixed step game state. Post may be called from any thread and never blocks, everything else belongs to the
+// simulation thread once it has started, including the BuildingData entities of the registry.
+class Simulation {
+public:
+  static const size_t commandCapacity = 4096;
+
+private:
+  entt::registry& registry;
+  BuildingInstances buildings;
+  int mapWidth, mapHeight;
+  float zoom;
+
+  MpscQueue<SimulationCommand> commands;
+
+  uint64_t stepCount;
+  glm::vec2 prevCameraPos, cameraPos;
+  glm::vec2 cameraDrag; // screen pixels dragged since the last step
+  float animTimer;
+  int animIndex;
+
+  void apply(const SimulationCommand& command);
+
+public:
+  Simulation(entt::registry& registry, int mapWidth, int mapHeight, float zoom);
+
+  /// Returns false when commandCapacity commands are already waiting for the next step, the command is dropped
+  bool Post(const SimulationCommand& command);
+
+  void Step(float dt);
+  void WriteSnapshot(RenderSnapshot& snapshot) const;
+};
+
+#endif //KINGDOM_SIMULATION_H
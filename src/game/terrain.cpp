@@ -2,10 +2,14 @@
 #include <iostream>
 #include <fstream>
 #include <string>
+#include <cstdint>
 #include "spdlog/spdlog.h"
 
 using namespace std;
 
+// Table entries no data line has set yet, tile indices can't take this value
+const int16_t unmappedTile = INT16_MIN;
+
 void splitLine(const string& buffer, vector<string> &strs) {
   size_t pos = buffer.find(' ');
   size_t initialPos = 0;
@@ -35,6 +39,11 @@ uint8_t directionToBitmask(const string& dir) {
 }
 
 Terrain::Terrain(const std::string& path) {
+  // table 0 is reserved for unknown terrain names and resolves everything to the error tile
+  std::array<int16_t, 256> errorTable;
+  errorTable.fill(ErrorTile);
+  tileTables.push_back(errorTable);
+
   // Open .terrain file and parse terrain data from it
   fstream terrain_file;
   terrain_file.open(path, ios::in);
@@ -66,26 +75,42 @@ Terrain::Terrain(const std::string& path) {
     //spdlog::info("TERRAIN TYPE {} : INDEX {} : MASK {:b}", terrainType, tileIndex, bitmask);
     tokens.clear();
 
-    // insert data into map
-    if (terrainData.find(terrainType) == terrainData.end())
-      terrainData.insert(std::pair(terrainType, std::map<uint8_t, int>()));
-    terrainData[terrainType].insert(std::pair(bitmask, tileIndex));
-  }
+    // intern the terrain name and insert data into its table, the first entry for a bitmask wins
+    auto terrain_it = terrainIds.find(terrainType);
+    if (terrain_it == terrainIds.end()) {
+      terrain_it = terrainIds.insert(std::pair(terrainType, int(tileTables.size()))).first;
 
-  terrain_file.close();
-}
+      std::array<int16_t, 256> table;
+      table.fill(unmappedTile);
+      tileTables.push_back(table);
+    }
 
-int Terrain::GetTileIndex(const string &terrain, uint8_t bitmask) const {
-  std::map<std::string, std::map<uint8_t, int>>::const_iterator terrain_it;
-  terrain_it = terrainData.find(terrain);
+    // Negative indices are valid, -1 is the empty tile, only what doesn't fit the table is rejected
+    if (tileIndex <= unmappedTile || tileIndex > INT16_MAX) {
+      spdlog::error("Tile index out of range ({}) in terrain file: {}", lineCount, path);
+      continue;
+    }
 
-  if (terrain_it != terrainData.end()) {
-    std::map<uint8_t, int>::const_iterator tile_it;
-    tile_it = terrain_it->second.find(bitmask);
+    auto& entry = tileTables[terrain_it->second][bitmask];
+    if (entry == unmappedTile) entry = int16_t(tileIndex);
+  }
+
+  terrain_file.close();
 
-    if (tile_it != terrain_it->second.end())
-      return tile_it->second;
+  // bake the fallback tile into every unmapped bitmask
+  for (auto& table : tileTables) {
+    for (auto& entry : table) {
+      if (entry == unmappedTile) entry = ErrorTile;
+    }
   }
+}
+
+int Terrain::GetTerrainId(const std::string& terrain) const {
+  auto terrain_it = terrainIds.find(terrain);
+  return (terrain_it != terrainIds.end()) ? terrain_it->second : 0;
+}
 
-  return 3; // 3 is errorTile, change later
+/// String lookup for tooling, hot paths should resolve the terrain id once and use the id overload
+int Terrain::GetTileIndex(const string &terrain, uint8_t bitmask) const {
+  return GetTileIndex(GetTerrainId(terrain), bitmask);
 }
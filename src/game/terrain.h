@@ -1,15 +1,29 @@
 #ifndef KINGDOM_TERRAIN_H
 #define KINGDOM_TERRAIN_H
 
+#include <array>
+#include <cstdint>
 #include <map>
 #include <string>
+#include <vector>
 
 class Terrain {
-  std::map<std::string, std::map<uint8_t, int>> terrainData;
+  // Terrain names are interned to ids at load time, every terrain is a flat bitmask -> tile index table
+  std::map<std::string, int> terrainIds;
+  std::vector<std::array<int16_t, 256>> tileTables;
 
 public:
+  static constexpr int16_t ErrorTile = 3; // 3 is errorTile, change later
+
   explicit Terrain(const std::string& path);
 
+  /// Unknown terrain names map to a table that only holds ErrorTile
+  int GetTerrainId(const std::string& terrain) const;
+
+  /// terrainId must come from GetTerrainId, unmapped bitmasks resolve to ErrorTile
+  int GetTileIndex(int terrainId, uint8_t bitmask) const {
+    return tileTables[terrainId][bitmask];
+  }
   int GetTileIndex(const std::string& terrain, uint8_t bitmask) const;
 };
 
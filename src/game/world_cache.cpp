@@ -0,0 +1,246 @@
+#include "world_cache.h"
+#include "world_generator.h"
+#include "spdlog/spdlog.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace worldgen;
+
+namespace {
+  static_assert(sizeof(int) == 4, "tileData is stored as 32-bit integers");
+
+  struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t seed;
+    int32_t width;
+    int32_t height;
+    int32_t depth;
+    uint64_t terrainHash;
+    uint64_t validTileCount;
+  };
+  const char cacheMagic[4] = { 'K', 'W', 'L', 'D' };
+
+  // Every array starts on an 8 byte boundary in the file
+  struct CacheLayout {
+    size_t heightmap, featuremap, tileData, tileFlags, fileSize;
+
+    CacheLayout(int width, int height, int depth) {
+      const size_t tiles = size_t(width) * height;
+      const size_t layeredTiles = tiles * depth;
+
+      heightmap  = align(sizeof(CacheHeader));
+      featuremap = align(heightmap + tiles);
+      tileData   = align(featuremap + tiles);
+      tileFlags  = align(tileData + layeredTiles * sizeof(int));
+      fileSize   = tileFlags + layeredTiles;
+    }
+
+    static size_t align(size_t offset) { return (offset + 7) & ~size_t(7); }
+  };
+
+  // Read-only view of a whole file, the pages are only pulled in as the arrays are copied out
+  class MappedFile {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+
+  public:
+    explicit MappedFile(const std::string& path) {
+#ifdef _WIN32
+      file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+      if (file == INVALID_HANDLE_VALUE) return;
+
+      LARGE_INTEGER fileSize;
+      if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) return;
+
+      mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+      if (mapping == nullptr) return;
+
+      data = (const uint8_t*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+      if (data != nullptr) size = size_t(fileSize.QuadPart);
+#else
+      const int fd = open(path.c_str(), O_RDONLY);
+      if (fd < 0) return;
+
+      struct stat info{};
+      if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        void* view = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (view != MAP_FAILED) {
+          data = (const uint8_t*)view;
+          size = size_t(info.st_size);
+        }
+      }
+      close(fd);
+#endif
+    }
+
+    ~MappedFile() {
+#ifdef _WIN32
+      if (data != nullptr) UnmapViewOfFile(data);
+      if (mapping != nullptr) CloseHandle(mapping);
+      if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+      if (data != nullptr) munmap((void*)data, size);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* Data() const { return data; }
+    size_t Size() const { return size; }
+  };
+
+  template <typename T>
+  void copyArray(std::vector<T>& vec, const uint8_t* source, size_t count) {
+    vec.resize(count);
+    std::memcpy(vec.data(), source, count * sizeof(T));
+  }
+
+  void writePadding(std::ofstream& file, size_t offset) {
+    const char zeros[8] = {};
+    const auto position = size_t(file.tellp());
+    if (offset > position) file.write(zeros, std::streamsize(offset - position));
+  }
+}
+
+uint64_t worldgen::HashTerrainFile(const std::string& terrainPath) {
+  std::ifstream file(terrainPath, std::ios::binary);
+
+  uint64_t hash = 0xcbf29ce484222325ull;
+  char buffer[4096];
+  while (file) {
+    file.read(buffer, sizeof(buffer));
+    for (std::streamsize i = 0; i < file.gcount(); i++) {
+      hash ^= uint8_t(buffer[i]);
+      hash *= 0x100000001b3ull;
+    }
+  }
+
+  return hash;
+}
+
+std::string worldgen::WorldCachePath(const std::string& cacheDir, uint32_t seed, int mapWidth, int mapHeight, uint64_t terrainHash) {
+  char name[96];
+  std::snprintf(name, sizeof(name), "world_%u_%dx%d_%016llx.bin", seed, mapWidth, mapHeight, (unsigned long long)terrainHash);
+  return (std::filesystem::path(cacheDir) / name).string();
+}
+
+bool worldgen::LoadWorldCache(const std::string& path, WorldData& worldData, uint32_t seed, uint64_t terrainHash) {
+  MappedFile file(path);
+  if (file.Data() == nullptr || file.Size() < sizeof(CacheHeader)) return false;
+
+  CacheHeader header{};
+  std::memcpy(&header, file.Data(), sizeof(header));
+
+  if (std::memcmp(header.magic, cacheMagic, sizeof(cacheMagic)) != 0 || header.version != worldCacheVersion ||
+      header.seed != seed || header.terrainHash != terrainHash ||
+      header.width != worldData.width || header.height != worldData.height || header.depth != worldData.depth) {
+    spdlog::info("World cache {} is stale, regenerating", path);
+    return false;
+  }
+
+  const CacheLayout layout(header.width, header.height, header.depth);
+  if (file.Size() != layout.fileSize) {
+    spdlog::warn("World cache {} has an unexpected size ({} bytes), regenerating", path, file.Size());
+    return false;
+  }
+
+  const size_t tiles = size_t(header.width) * header.height;
+  const size_t layeredTiles = tiles * header.depth;
+  copyArray(worldData.heightmap, file.Data() + layout.heightmap, tiles);
+  copyArray(worldData.featuremap, file.Data() + layout.featuremap, tiles);
+  copyArray(worldData.tileData, file.Data() + layout.tileData, layeredTiles);
+  copyArray(worldData.tileFlags, file.Data() + layout.tileFlags, layeredTiles);
+  worldData.validTileCount = size_t(header.validTileCount);
+
+  return true;
+}
+
+bool worldgen::SaveWorldCache(const std::string& path, const WorldData& worldData, uint32_t seed, uint64_t terrainHash) {
+  std::error_code error;
+  const auto directory = std::filesystem::path(path).parent_path();
+  if (!directory.empty()) std::filesystem::create_directories(directory, error);
+
+  // Written next to the final path and renamed into place, so a crash never leaves a truncated cache behind
+  const std::string tempPath = path + ".tmp";
+  {
+    std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+      spdlog::warn("Failed to create world cache {}", tempPath);
+      return false;
+    }
+
+    CacheHeader header{};
+    std::memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+    header.version = worldCacheVersion;
+    header.seed = seed;
+    header.width = worldData.width;
+    header.height = worldData.height;
+    header.depth = worldData.depth;
+    header.terrainHash = terrainHash;
+    header.validTileCount = worldData.validTileCount;
+
+    const CacheLayout layout(header.width, header.height, header.depth);
+    file.write((const char*)&header, sizeof(header));
+    writePadding(file, layout.heightmap);
+    file.write((const char*)worldData.heightmap.data(), std::streamsize(worldData.heightmap.size()));
+    writePadding(file, layout.featuremap);
+    file.write((const char*)worldData.featuremap.data(), std::streamsize(worldData.featuremap.size()));
+    writePadding(file, layout.tileData);
+    file.write((const char*)worldData.tileData.data(), std::streamsize(worldData.tileData.size() * sizeof(int)));
+    writePadding(file, layout.tileFlags);
+    file.write((const char*)worldData.tileFlags.data(), std::streamsize(worldData.tileFlags.size()));
+
+    if (!file || size_t(file.tellp()) != layout.fileSize) {
+      spdlog::warn("Failed to write world cache {}", tempPath);
+      file.close();
+      std::filesystem::remove(tempPath, error);
+      return false;
+    }
+  }
+
+  std::filesystem::rename(tempPath, path, error);
+  if (error) {
+    spdlog::warn("Failed to move world cache into place at {}: {}", path, error.message());
+    std::filesystem::remove(tempPath, error);
+    return false;
+  }
+
+  return true;
+}
+
+WorldData worldgen::LoadOrGenerateGameWorld(const std::string& terrainPath, const std::string& cacheDir, uint32_t seed,
+                                            int mapWidth, int mapHeight, int threadCount) {
+  const uint64_t terrainHash = HashTerrainFile(terrainPath);
+  const std::string path = WorldCachePath(cacheDir, seed, mapWidth, mapHeight, terrainHash);
+
+  // A miss leaves the arrays untouched, so the same world is generated into on a miss
+  WorldData worldData(terrainPath, mapWidth, mapHeight, 5);
+  if (LoadWorldCache(path, worldData, seed, terrainHash)) {
+    spdlog::info("Loaded world {} ({}x{}) from cache", seed, mapWidth, mapHeight);
+    return worldData;
+  }
+
+  GenerateGameWorld(worldData, seed, threadCount);
+  SaveWorldCache(path, worldData, seed, terrainHash);
+
+  return worldData;
+}
@@ -0,0 +1,26 @@
+#ifndef KINGDOM_WORLD_CACHE_H
+#define KINGDOM_WORLD_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include "world_data.h"
+
+namespace worldgen {
+  // Bump whenever the generated output or the file layout changes, older cache files are then ignored
+  const uint32_t worldCacheVersion = 1;
+
+  /// FNV-1a hash of the terrain file contents, part of the cache key so edited terrains invalidate the cache
+  uint64_t HashTerrainFile(const std::string& terrainPath);
+
+  std::string WorldCachePath(const std::string& cacheDir, uint32_t seed, int mapWidth, int mapHeight, uint64_t terrainHash);
+
+  /// Maps the cache file and fills the world arrays from it, returns false on a miss or a stale/corrupt file
+  bool LoadWorldCache(const std::string& path, WorldData& worldData, uint32_t seed, uint64_t terrainHash);
+  bool SaveWorldCache(const std::string& path, const WorldData& worldData, uint32_t seed, uint64_t terrainHash);
+
+  /// GenerateGameWorld backed by the on-disk cache, a fresh world is written back to the cache
+  WorldData LoadOrGenerateGameWorld(const std::string& terrainPath, const std::string& cacheDir, uint32_t seed,
+                                    int mapWidth, int mapHeight, int threadCount = 0);
+}
+
+#endif //KINGDOM_WORLD_CACHE_H
@@ -17,7 +17,7 @@ struct WorldData {
   Terrain terrainSet;
   std::map<int, std::array<int, 4>> animTable;
 
-  std::vector<float> heightmap;
+  std::vector<uint8_t> heightmap; // elevation levels 0 - 4
   std::vector<uint8_t> featuremap;
 
   std::vector<int> tileData;
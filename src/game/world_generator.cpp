@@ -2,217 +2,507 @@
 #include "../math/perlin.h"
 #include "../math/func.h"
 #include "../math/rng.h"
+#include "../math/parallel.h"
 #include "spdlog/spdlog.h"
+#include <algorithm>
 #include <vector>
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
 using namespace worldgen;
 
 const int waterTile = 801;
 
-WorldData worldgen::GenerateGameWorld(const std::string& terrainPath, uint32_t seed, int mapWidth, int mapHeight) {
-  WorldData worldData(terrainPath, mapWidth, mapHeight, 5);
+namespace {
+  // Neighbour bitmasks are computed for a few rows at a time so the scratch buffers stay small and in cache
+  const int bitmaskBlockRows = 32;
 
-  // Get generated heightmap and squash values
-  worldData.heightmap = GenerateHeightmap(seed, mapWidth, mapHeight);
-  for (auto& value : worldData.heightmap) {
-    value = (value <= 0.4f) ? 0.f : (value <= 0.55f) ? 1.f : (value <= 0.6f) ? 2.f : (value <= 0.65f) ? 3.f : 4.f;
+  template <typename Fn>
+  void forEachRowBlock(int firstRow, int lastRow, int mapWidth, const Fn& fn) {
+    for (int row = firstRow; row < lastRow; row += bitmaskBlockRows) {
+      const int blockEnd = std::min(row + bitmaskBlockRows, lastRow);
+      fn(size_t(row) * mapWidth, size_t(blockEnd) * mapWidth);
+    }
   }
+}
 
-  // Generate features based off heightmap
-  worldData.featuremap = GenerateFeatureMap(seed, worldData.heightmap, mapWidth, mapHeight);
-  CreateTileMap(worldData);
+namespace {
+  // spreadTable[b] holds bit i of b in the lowest bit of byte i, used to turn 8 direction bits into 8 bitmask bytes
+  struct SpreadTable {
+    uint64_t values[256];
 
-  return worldData;
-}
+    constexpr SpreadTable() : values() {
+      for (int i = 0; i < 256; i++) {
+        for (int bit = 0; bit < 8; bit++) {
+          if ((i >> bit) & 1) values[i] |= uint64_t(1) << (bit * 8);
+        }
+      }
+    }
+  };
+  constexpr SpreadTable spreadTable;
+
+  // Tile tests used to pack bit planes, each one has a scalar form and a 16 tile SSE2 form
+  struct FlagMatch {
+    uint8_t flag;
+
+    bool operator()(uint8_t value) const { return (value & flag) == flag; }
+#if defined(__SSE2__) || defined(_M_X64)
+    __m128i operator()(__m128i values) const {
+      const __m128i flags = _mm_set1_epi8(char(flag));
+      return _mm_cmpeq_epi8(_mm_and_si128(values, flags), flags);
+    }
+#endif
+  };
 
-std::vector<float> worldgen::GenerateHeightmap(const uint32_t seed, const int mapWidth, const int mapHeight) {
-  const size_t nTiles = mapWidth * mapHeight;
-  std::vector<float> heightmap(nTiles, 0.f);
+  struct LevelEquals {
+    uint8_t level;
 
-  // create basic circle
-  const int centerX = mapWidth / 2;
-  const int centerY = mapHeight / 2;
-  const float maxDistance = dist(0, 0, centerX, centerY);
+    bool operator()(uint8_t value) const { return value == level; }
+#if defined(__SSE2__) || defined(_M_X64)
+    __m128i operator()(__m128i values) const { return _mm_cmpeq_epi8(values, _mm_set1_epi8(char(level))); }
+#endif
+  };
 
-  for (size_t i = 0; i < nTiles; i++) {
-    const int x = i % mapWidth;
-    const int y = i / mapWidth;
+  struct LevelAtLeast {
+    uint8_t level;
 
-    heightmap[i] = 1.f - (dist(x, y, centerX, centerY) / maxDistance);
-  }
+    bool operator()(uint8_t value) const { return value >= level; }
+#if defined(__SSE2__) || defined(_M_X64)
+    __m128i operator()(__m128i values) const {
+      return _mm_cmpeq_epi8(_mm_max_epu8(values, _mm_set1_epi8(char(level))), values);
+    }
+#endif
+  };
+
+  // Packs the test results for tiles [start, start + 64) into one word, tiles outside the map count as set
+  template <typename Test>
+  uint64_t packWord(const std::vector<uint8_t>& vec, int64_t start, const Test& test) {
+    const int64_t len = int64_t(vec.size());
+    uint64_t bits = 0;
+
+    if (start >= 0 && start + 64 <= len) {
+      const uint8_t* values = vec.data() + start;
+#if defined(__SSE2__) || defined(_M_X64)
+      // 16 tiles per compare, movemask gathers the per-byte results into bits
+      for (unsigned chunk = 0; chunk < 4; chunk++) {
+        const __m128i hit = test(_mm_loadu_si128((const __m128i*)(values + chunk * 16)));
+        bits |= uint64_t(uint16_t(_mm_movemask_epi8(hit))) << (chunk * 16);
+      }
+#else
+      for (unsigned bit = 0; bit < 64; bit++) {
+        bits |= uint64_t(test(values[bit])) << bit;
+      }
+#endif
+    } else {
+      for (unsigned bit = 0; bit < 64; bit++) {
+        const int64_t index = start + bit;
+        const bool set = index < 0 || index >= len || test(vec[size_t(index)]);
+        bits |= uint64_t(set) << bit;
+      }
+    }
 
-  // perlin noise generator
-  Perlin perlin(seed);
+    return bits;
+  }
 
-  float highest = -1.f;
+  // Reads 64 bits of the plane starting at an arbitrary bit position
+  inline uint64_t bitWindow(const uint64_t* plane, size_t position) {
+    const size_t word = position >> 6;
+    const unsigned shift = unsigned(position & 63);
+    if (shift == 0) return plane[word];
+    return (plane[word] >> shift) | (plane[word + 1] << (64 - shift));
+  }
 
-  // layer noise to vary elevation
-  for (size_t i = 0; i < nTiles; i++) {
-    // bounded coordinates between 0.f and 1.f
-    const float x = float(i % mapWidth) / float(mapWidth);
-    const float y = float(i / mapWidth) / float(mapHeight);
+  // Derives the neighbour bitmasks of count consecutive tiles, the first of which sits at bit position center.
+  // The plane has to cover mapWidth + 1 bits on either side of the range, plus one spare word at the end.
+  void planeBitmasks(const uint64_t* plane, size_t center, int mapWidth, size_t count, uint8_t* out) {
+    const size_t width = size_t(mapWidth);
+
+    for (size_t j = 0; j < count; j += 64) {
+      const size_t p = center + j;
+      const uint64_t n  = bitWindow(plane, p - width);
+      const uint64_t w  = bitWindow(plane, p - 1);
+      const uint64_t e  = bitWindow(plane, p + 1);
+      const uint64_t s  = bitWindow(plane, p + width);
+
+      // corners only count when both adjacent edges are set
+      const uint64_t nw = bitWindow(plane, p - width - 1) & n & w;
+      const uint64_t ne = bitWindow(plane, p - width + 1) & n & e;
+      const uint64_t sw = bitWindow(plane, p + width - 1) & s & w;
+      const uint64_t se = bitWindow(plane, p + width + 1) & s & e;
+
+      // transpose the 8 direction words into one bitmask byte per tile, 8 tiles at a time
+      const size_t lanes = std::min<size_t>(64, count - j);
+      for (size_t group = 0; group < lanes; group += 8) {
+        const unsigned shift = unsigned(group);
+        const uint64_t masks =
+            (spreadTable.values[(nw >> shift) & 0xFF] << 0) |
+            (spreadTable.values[(n  >> shift) & 0xFF] << 1) |
+            (spreadTable.values[(ne >> shift) & 0xFF] << 2) |
+            (spreadTable.values[(w  >> shift) & 0xFF] << 3) |
+            (spreadTable.values[(e  >> shift) & 0xFF] << 4) |
+            (spreadTable.values[(sw >> shift) & 0xFF] << 5) |
+            (spreadTable.values[(s  >> shift) & 0xFF] << 6) |
+            (spreadTable.values[(se >> shift) & 0xFF] << 7);
+
+        const size_t bytes = std::min<size_t>(8, lanes - group);
+        for (size_t b = 0; b < bytes; b++) {
+          out[j + group + b] = uint8_t(masks >> (b * 8));
+        }
+      }
+    }
+  }
 
-    const float n1 = heightmap[i];
-    const float n2 = 1.3f * perlin.Noise(x, y, 0.f);
-    const float n3 = 1.3f * perlin.Noise(5.f * x, 5.f * y, 0.f);
-    const float n4 = 1.3f * perlin.Noise(10.f * x, 10.f * y, 0.f);
-    const float n5 = 1.3f * perlin.Noise(20.f * x, 20.f * y, 0.f);
+  // Whole map bit plane, tile i is stored at bit halo + i and the halo on either side counts as set
+  struct BitPlane {
+    std::vector<uint64_t> words;
+    size_t halo;
+  };
+
+  template <typename Test>
+  BitPlane packBitPlane(const std::vector<uint8_t>& vec, int mapWidth, const Test& test, int threadCount) {
+    BitPlane plane;
+    plane.halo = size_t(mapWidth) + 1;
+
+    const size_t wordCount = (vec.size() + plane.halo * 2 + 63) / 64;
+    plane.words.assign(wordCount + 1, 0);
+    ForEachRowBand(int(wordCount), threadCount, [&](int firstWord, int lastWord, int) {
+      for (int word = firstWord; word < lastWord; word++) {
+        plane.words[word] = packWord(vec, int64_t(word) * 64 - int64_t(plane.halo), test);
+      }
+    });
 
-    float elevation = n1 * ((n2 + n3 + n4 + n5) / 4.f);
-    if (elevation > 1.f) elevation = 1.f; // bounds checking
-    if (elevation < 0.f) elevation = 0.f;
-    if (elevation > highest) highest = elevation;
+    return plane;
+  }
 
-    heightmap[i] = elevation;
+  inline uint8_t quantizeElevation(float value) {
+    return (value <= 0.4f) ? 0 : (value <= 0.55f) ? 1 : (value <= 0.6f) ? 2 : (value <= 0.65f) ? 3 : 4;
   }
 
-  // spdlog::info("Highest Point: {}", highest);
+  // Samples elevation a row at a time: a radial falloff from the map center layered with 4 octaves of noise
+  class ElevationSampler {
+    const Perlin::Slice& surface;
+    int mapWidth, mapHeight;
+    int centerX, centerY;
+    float maxDistance;
+
+    std::vector<float> xs, ys;
+    std::vector<float> octaves[4];
+
+  public:
+    ElevationSampler(const Perlin::Slice& surface, int mapWidth, int mapHeight)
+      : surface(surface), mapWidth(mapWidth), mapHeight(mapHeight),
+        centerX(mapWidth / 2), centerY(mapHeight / 2), maxDistance(dist(0, 0, mapWidth / 2, mapHeight / 2)),
+        xs(mapWidth), ys(mapWidth) {
+      for (auto& octave : octaves) octave.resize(mapWidth);
+    }
 
-  return heightmap;
-}
+    void SampleRow(int y, float* out) {
+      const float frequencies[] = { 1.f, 5.f, 10.f, 20.f };
 
-std::vector<uint8_t> worldgen::GenerateFeatureMap(uint32_t seed, std::vector<float> heightmap, int mapWidth, int mapHeight) {
-  auto featureMap = std::vector<uint8_t>(mapWidth * mapHeight, waterFeature);
+      // bounded coordinates between 0.f and 1.f
+      const float yf = float(y) / float(mapHeight);
 
-  // First generate landmass and determine land borders, then we place mountains and trees, avoiding the borders
-  for (size_t i = 0; i < mapWidth * mapHeight; i++) {
-    if (heightmap[i] == 0.f) featureMap[i] = waterFeature;
-    if (heightmap[i] == 1.f) featureMap[i] = landFeature;
-  }
+      for (int o = 0; o < 4; o++) {
+        for (int x = 0; x < mapWidth; x++) {
+          xs[x] = frequencies[o] * (float(x) / float(mapWidth));
+          ys[x] = frequencies[o] * yf;
+        }
+        surface.Noise(xs.data(), ys.data(), octaves[o].data(), mapWidth);
+      }
 
-  // Determine land borders by calculating bitmasks and adding a flag to indicate borders
-  for (size_t i = 0; i < mapWidth * mapHeight; i++) {
-    if ((featureMap[i] & landFeature) == landFeature) {
-      const int bitmask = calculateBitmask(featureMap, i, landFeature, mapWidth);
-      if (bitmask != 0b11111111) featureMap[i] |= borderFlag;
-    }
-  }
+      for (int x = 0; x < mapWidth; x++) {
+        const float n1 = 1.f - (dist(x, y, centerX, centerY) / maxDistance);
+        const float n2 = 1.3f * octaves[0][x];
+        const float n3 = 1.3f * octaves[1][x];
+        const float n4 = 1.3f * octaves[2][x];
+        const float n5 = 1.3f * octaves[3][x];
 
-  // Place mountains on land and not on borders
-  for (size_t i = 0; i < mapWidth * mapHeight; i++) {
-    if (heightmap[i] >= 2.f && (featureMap[i] & borderFlag) != borderFlag) {
-      if (heightmap[i] == 2.f) featureMap[i] = level1Feature;
-      if (heightmap[i] == 3.f) featureMap[i] = level2Feature;
-      if (heightmap[i] == 4.f) featureMap[i] = level3Feature;
-    }
-  }
+        float elevation = n1 * ((n2 + n3 + n4 + n5) / 4.f);
+        if (elevation > 1.f) elevation = 1.f; // bounds checking
+        if (elevation < 0.f) elevation = 0.f;
 
-  // Determine mountain borders by calculating bitmasks and adding a flag
-  for (size_t i = 0; i < mapWidth * mapHeight; i++) {
-    if ((featureMap[i] & mountainFeature) == mountainFeature) {
-      const int bitmask = calculateBitmask(featureMap, i, mountainFeature, mapWidth);
-      if (bitmask != 0b11111111) featureMap[i] |= borderFlag;
+        out[x] = elevation;
+      }
     }
+  };
+}
+
+void worldgen::calculateBitmasks(const std::vector<uint8_t>& vec, uint8_t flag, int mapWidth, size_t first, size_t last, uint8_t* out) {
+  if (last <= first) return;
+
+  // Pack the flag for tiles [first - halo, last + halo) into a bit plane, tiles outside the map count as set
+  const int64_t halo = int64_t(mapWidth) + 1;
+  const int64_t base = int64_t(first) - halo;
+  const size_t count = last - first;
+
+  const size_t wordCount = (count + size_t(halo) * 2 + 63) / 64;
+  std::vector<uint64_t> plane(wordCount + 1, 0);
+  for (size_t word = 0; word < wordCount; word++) {
+    plane[word] = packWord(vec, base + int64_t(word * 64), FlagMatch{flag});
   }
 
-  Perlin perlin(seed);
+  // bit position of tile first + j in the plane is halo + j, neighbours are at fixed offsets from it
+  planeBitmasks(plane.data(), size_t(halo), mapWidth, count, out);
+}
 
-  for (size_t i = 0; i < mapWidth * mapHeight; i++) {
-    if (featureMap[i] == landFeature) {
-      const size_t x = i % mapWidth;
-      const size_t y = i / mapWidth;
+WorldData worldgen::GenerateGameWorld(const std::string& terrainPath, uint32_t seed, int mapWidth, int mapHeight, int threadCount) {
+  WorldData worldData(terrainPath, mapWidth, mapHeight, 5);
+  GenerateGameWorld(worldData, seed, threadCount);
 
-      const float xf = float(x) / float(mapWidth);
-      const float yf = float(y) / float(mapHeight);
+  return worldData;
+}
 
-      /*const float s0 = perlin.Noise(xf, yf, 0.f);
-      const float s1 = perlin.Noise(50.f * xf, 50.f * yf, 2.f);
-      const float s2 = perlin.Noise(200.f * xf, 200.f * yf, 4.f);
+void worldgen::GenerateGameWorld(WorldData& worldData, uint32_t seed, int threadCount) {
+  // Generate the quantized elevation and features based off of it
+  worldData.heightmap = GenerateElevationLevels(seed, worldData.width, worldData.height, threadCount);
+  worldData.featuremap = GenerateFeatureMap(seed, worldData.heightmap, worldData.width, worldData.height, threadCount);
+  CreateTileMap(worldData, seed, threadCount);
+}
 
-      if (featureMap[i] == landFeature && (s0 + s1 + s2) / 3.f >= 0.55f) {
-        featureMap[i] = forestFeature;
-      }*/
+std::vector<float> worldgen::GenerateHeightmap(const uint32_t seed, const int mapWidth, const int mapHeight, const int threadCount) {
+  std::vector<float> heightmap(size_t(mapWidth) * mapHeight, 0.f);
 
-      const float s0 = perlin.Noise(0.5f * xf, 0.5f * yf, 0.f);
-      const float s1 = perlin.Noise(200.f * xf, 200.f * yf, 2.f);
+  // perlin noise generator, every octave samples the z = 0 plane
+  Perlin perlin(seed);
+  const auto surface = perlin.SliceAt(0.f);
 
-      if (s0 >= 0.6f || s1 >= 0.5f) {
-        featureMap[i] = forestFeature;
-      }
+  ForEachRowBand(mapHeight, threadCount, [&](int firstRow, int lastRow, int) {
+    ElevationSampler sampler(surface, mapWidth, mapHeight);
+    for (int y = firstRow; y < lastRow; y++) {
+      sampler.SampleRow(y, heightmap.data() + size_t(y) * mapWidth);
     }
-  }
+  });
 
-  return featureMap;
+  return heightmap;
 }
 
-void worldgen::CreateTileMap(WorldData &worldData) {
-  const int mapWidth = worldData.width;
-  const int mapHeight = worldData.height;
-  const int mapDepth = worldData.depth;
+std::vector<uint8_t> worldgen::GenerateElevationLevels(const uint32_t seed, const int mapWidth, const int mapHeight, const int threadCount) {
+  std::vector<uint8_t> levels(size_t(mapWidth) * mapHeight, 0);
 
-  size_t validTileCount = 0;
-  for (size_t i = 0; i < mapWidth * mapHeight; i++) {
-    const int x = int(i % mapWidth);
-    const int y = int(i / mapWidth);
-
-    // Set first layer tile to water
-    worldData.SetTileIndex(x, y, 0, waterTile);
-    validTileCount++;
-
-    // Check if the tile is on land
-    if ((worldData.featuremap[i] & landFeature) == landFeature) {
-      const uint8_t bitmask = calculateBitmask(worldData.featuremap, i, landFeature, mapWidth);
-      int index = worldData.terrainSet.GetTileIndex("land", bitmask);
-
-      // randomly vary between the base grass tiles
-      if (index == 0) {
-        index = rng::next_int(3); // 0 - 2 are base grass tiles
-      }
+  Perlin perlin(seed);
+  const auto surface = perlin.SliceAt(0.f);
+
+  ForEachRowBand(mapHeight, threadCount, [&](int firstRow, int lastRow, int) {
+    // Elevation only lives in a one row scratch buffer before it is squashed down to a level
+    ElevationSampler sampler(surface, mapWidth, mapHeight);
+    std::vector<float> row(mapWidth);
+
+    for (int y = firstRow; y < lastRow; y++) {
+      sampler.SampleRow(y, row.data());
 
-      worldData.SetTileIndex(x, y, 1, index);
-      validTileCount++;
+      uint8_t* out = levels.data() + size_t(y) * mapWidth;
+      for (int x = 0; x < mapWidth; x++) out[x] = quantizeElevation(row[x]);
     }
+  });
 
-    // Check for mountain or forest features
-    if ((worldData.featuremap[i] & mountainFeature) == mountainFeature) {
-      const auto level1Bitmask = calculateBitmask(worldData.featuremap, i, level1Feature, mapWidth);
-      const auto level2Bitmask = calculateBitmask(worldData.featuremap, i, level2Feature, mapWidth);
-      const auto level3Bitmask = calculateBitmask(worldData.featuremap, i, level3Feature, mapWidth);
+  return levels;
+}
 
-      // Determine elevation based on feature flags
-      if ((worldData.featuremap[i] & level1Feature) == level1Feature) {
-        const uint8_t bitmask = level3Bitmask | level2Bitmask | level1Bitmask;
+std::vector<uint8_t> worldgen::GenerateFeatureMap(uint32_t seed, const std::vector<uint8_t>& levels, int mapWidth, int mapHeight, int threadCount) {
+  auto featureMap = std::vector<uint8_t>(size_t(mapWidth) * mapHeight, waterFeature);
 
-        int index = worldData.terrainSet.GetTileIndex("mountain", bitmask);
-        worldData.SetTileIndex(x, y, 2, index);
-        validTileCount++;
-      }
+  // Only level 1 becomes land before mountains are placed and every higher level becomes a mountain,
+  // so both border tests can be packed straight from the levels and each tile is written exactly once
+  const auto landPlane = packBitPlane(levels, mapWidth, LevelEquals{1}, threadCount);
+  const auto mountainPlane = packBitPlane(levels, mapWidth, LevelAtLeast{2}, threadCount);
 
-      if ((worldData.featuremap[i] & level2Feature) == level2Feature) {
-        const uint8_t bitmask = level3Bitmask | level2Bitmask;
+  Perlin perlin(seed);
+  const auto coarseSlice = perlin.SliceAt(0.f);
+  const auto detailSlice = perlin.SliceAt(2.f);
+
+  ForEachRowBand(mapHeight, threadCount, [&](int firstRow, int lastRow, int) {
+    std::vector<uint8_t> landMasks, mountainMasks;
+
+    // Forests only grow on plain land tiles, gather those per row and evaluate their noise as one batch
+    std::vector<size_t> candidates;
+    std::vector<float> xs, ys, scaledX, scaledY, s0, s1;
+    candidates.reserve(mapWidth);
+
+    forEachRowBlock(firstRow, lastRow, mapWidth, [&](size_t first, size_t last) {
+      const size_t count = last - first;
+      landMasks.resize(count);
+      mountainMasks.resize(count);
+      planeBitmasks(landPlane.words.data(), landPlane.halo + first, mapWidth, count, landMasks.data());
+      planeBitmasks(mountainPlane.words.data(), mountainPlane.halo + first, mapWidth, count, mountainMasks.data());
+
+      // Land and mountains, flagging the tiles along their borders
+      for (size_t i = first; i < last; i++) {
+        const uint8_t level = levels[i];
+        const size_t local = i - first;
+
+        if (level == 1) {
+          featureMap[i] = landFeature | (landMasks[local] != 0b11111111 ? borderFlag : 0);
+        } else if (level >= 2) {
+          const uint8_t feature = (level == 2) ? level1Feature : (level == 3) ? level2Feature : level3Feature;
+          featureMap[i] = feature | (mountainMasks[local] != 0b11111111 ? borderFlag : 0);
+        }
+      }
 
-        int index = worldData.terrainSet.GetTileIndex("mountain", bitmask);
-        worldData.SetTileIndex(x, y, 3, index);
-        validTileCount++;
+      // Forests within the block
+      for (int y = int(first / mapWidth); y < int(last / mapWidth); y++) {
+        const float yf = float(y) / float(mapHeight);
+
+        candidates.clear();
+        xs.clear(); ys.clear();
+        for (int x = 0; x < mapWidth; x++) {
+          const size_t i = x + size_t(y) * mapWidth;
+          if (featureMap[i] != landFeature) continue;
+
+          const float xf = float(x) / float(mapWidth);
+          candidates.push_back(i);
+          xs.push_back(xf);
+          ys.push_back(yf);
+        }
+
+        const size_t candidateCount = candidates.size();
+        if (candidateCount == 0) continue;
+
+        /*const float s0 = perlin.Noise(xf, yf, 0.f);
+        const float s1 = perlin.Noise(50.f * xf, 50.f * yf, 2.f);
+        const float s2 = perlin.Noise(200.f * xf, 200.f * yf, 4.f);
+
+        if (featureMap[i] == landFeature && (s0 + s1 + s2) / 3.f >= 0.55f) {
+          featureMap[i] = forestFeature;
+        }*/
+
+        s0.resize(candidateCount);
+        s1.resize(candidateCount);
+        scaledX.resize(candidateCount);
+        scaledY.resize(candidateCount);
+
+        for (size_t c = 0; c < candidateCount; c++) {
+          scaledX[c] = 0.5f * xs[c];
+          scaledY[c] = 0.5f * ys[c];
+        }
+        coarseSlice.Noise(scaledX.data(), scaledY.data(), s0.data(), candidateCount);
+
+        for (size_t c = 0; c < candidateCount; c++) {
+          scaledX[c] = 200.f * xs[c];
+          scaledY[c] = 200.f * ys[c];
+        }
+        detailSlice.Noise(scaledX.data(), scaledY.data(), s1.data(), candidateCount);
+
+        for (size_t c = 0; c < candidateCount; c++) {
+          if (s0[c] >= 0.6f || s1[c] >= 0.5f) {
+            featureMap[candidates[c]] = forestFeature;
+          }
+        }
       }
+    });
+  });
 
-      if ((worldData.featuremap[i] & level3Feature) == level3Feature) {
-        const uint8_t bitmask =  level3Bitmask;
+  return featureMap;
+}
 
-        int index = worldData.terrainSet.GetTileIndex("mountain", bitmask);
-        worldData.SetTileIndex(x, y, 4, index);
+void worldgen::CreateTileMap(WorldData &worldData, uint32_t seed, int threadCount) {
+  const int mapWidth = worldData.width;
+  const int mapHeight = worldData.height;
+  const int mapDepth = worldData.depth;
+
+  std::vector<size_t> bandTileCounts(ResolveThreadCount(threadCount), 0);
+  ForEachRowBand(mapHeight, threadCount, [&](int firstRow, int lastRow, int band) {
+    const auto& featureMap = worldData.featuremap;
+    const int landTerrain = worldData.terrainSet.GetTerrainId("land");
+    const int mountainTerrain = worldData.terrainSet.GetTerrainId("mountain");
+    const int forestTerrain = worldData.terrainSet.GetTerrainId("forest");
+    std::vector<uint8_t> landMasks, level1Masks, level2Masks, level3Masks, forestMasks;
+
+    size_t validTileCount = 0;
+    forEachRowBlock(firstRow, lastRow, mapWidth, [&](size_t first, size_t last) {
+      const size_t count = last - first;
+      landMasks.resize(count);
+      level1Masks.resize(count);
+      level2Masks.resize(count);
+      level3Masks.resize(count);
+      forestMasks.resize(count);
+
+      calculateBitmasks(featureMap, landFeature, mapWidth, first, last, landMasks.data());
+      calculateBitmasks(featureMap, level1Feature, mapWidth, first, last, level1Masks.data());
+      calculateBitmasks(featureMap, level2Feature, mapWidth, first, last, level2Masks.data());
+      calculateBitmasks(featureMap, level3Feature, mapWidth, first, last, level3Masks.data());
+      calculateBitmasks(featureMap, forestFeature, mapWidth, first, last, forestMasks.data());
+
+      for (size_t i = first; i < last; i++) {
+        const int x = int(i % mapWidth);
+        const int y = int(i / mapWidth);
+        const size_t local = i - first;
+
+        // Set first layer tile to water
+        worldData.SetTileIndex(x, y, 0, waterTile);
         validTileCount++;
+
+        // Check if the tile is on land
+        if ((featureMap[i] & landFeature) == landFeature) {
+          int index = worldData.terrainSet.GetTileIndex(landTerrain, landMasks[local]);
+
+          // randomly vary between the base grass tiles
+          if (index == 0) {
+            index = rng::int_at(seed, x, y, 1, 3); // 0 - 2 are base grass tiles
+          }
+
+          worldData.SetTileIndex(x, y, 1, index);
+          validTileCount++;
+        }
+
+        // Check for mountain or forest features
+        if ((featureMap[i] & mountainFeature) == mountainFeature) {
+          const auto level1Bitmask = level1Masks[local];
+          const auto level2Bitmask = level2Masks[local];
+          const auto level3Bitmask = level3Masks[local];
+
+          // Determine elevation based on feature flags
+          if ((featureMap[i] & level1Feature) == level1Feature) {
+            const uint8_t bitmask = level3Bitmask | level2Bitmask | level1Bitmask;
+
+            int index = worldData.terrainSet.GetTileIndex(mountainTerrain, bitmask);
+            worldData.SetTileIndex(x, y, 2, index);
+            validTileCount++;
+          }
+
+          if ((featureMap[i] & level2Feature) == level2Feature) {
+            const uint8_t bitmask = level3Bitmask | level2Bitmask;
+
+            int index = worldData.terrainSet.GetTileIndex(mountainTerrain, bitmask);
+            worldData.SetTileIndex(x, y, 3, index);
+            validTileCount++;
+          }
+
+          if ((featureMap[i] & level3Feature) == level3Feature) {
+            const uint8_t bitmask =  level3Bitmask;
+
+            int index = worldData.terrainSet.GetTileIndex(mountainTerrain, bitmask);
+            worldData.SetTileIndex(x, y, 4, index);
+            validTileCount++;
+          }
+        } else if ((featureMap[i] & forestFeature) == forestFeature) {
+          int index = worldData.terrainSet.GetTileIndex(forestTerrain, forestMasks[local]);
+
+          // randomly vary between the base forest tiles
+          if (index == 321) {
+            const int rand = rng::int_at(seed, x, y, 2, 0, 3);
+            index = (rand == 0) ? 321 : (rand == 1) ? 285 : 325;
+          }
+
+          worldData.SetTileIndex(x, y, 2, index);
+          validTileCount++;
+        }
       }
-    } else if ((worldData.featuremap[i] & forestFeature) == forestFeature) {
-      const uint8_t bitmask = calculateBitmask(worldData.featuremap, i, forestFeature, mapWidth);
-      int index = worldData.terrainSet.GetTileIndex("forest", bitmask);
-
-      // randomly vary between the base forest tiles
-      if (index == 321) {
-        const int rand = rng::next_int(0, 3);
-        index = (rand == 0) ? 321 : (rand == 1) ? 285 : 325;
-      }
+    });
 
-      worldData.SetTileIndex(x, y, 2, index);
-      validTileCount++;
-    }
-  }
+    bandTileCounts[band] = validTileCount;
+  });
 
   // Set tile flags
-  for (size_t i = 0; i < mapWidth * mapHeight * mapDepth; i++) {
-    if (worldData.animTable.find(worldData.tileData[i]) != worldData.animTable.end())
-      worldData.tileFlags[i] = uint8_t(TILE_FLAGS::Anim);
-  }
+  ForEachRowBand(mapHeight * mapDepth, threadCount, [&](int firstRow, int lastRow, int) {
+    for (size_t i = size_t(firstRow) * mapWidth; i < size_t(lastRow) * mapWidth; i++) {
+      if (worldData.animTable.find(worldData.tileData[i]) != worldData.animTable.end())
+        worldData.tileFlags[i] = uint8_t(TILE_FLAGS::Anim);
+    }
+  });
 
+  size_t validTileCount = 0;
+  for (auto count : bandTileCounts) validTileCount += count;
   worldData.validTileCount = validTileCount;
 }
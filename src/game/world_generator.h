@@ -85,11 +85,22 @@ namespace worldgen {
     return bitmask;
   }
 
-  WorldData GenerateGameWorld(const std::string& terrainPath, uint32_t seed, int mapWidth, int mapHeight);
-
-  std::vector<float> GenerateHeightmap(uint32_t seed, int mapWidth, int mapHeight);
-  std::vector<uint8_t> GenerateFeatureMap(uint32_t seed, std::vector<float> heightmap, int mapWidth, int mapHeight);
-  void CreateTileMap(WorldData& worldData);
+  // Bit-parallel equivalent of calculateBitmask for every tile in [first, last), results are written to out[0..last-first).
+  // The flag is packed into a bit plane and all 8 neighbour masks are derived 64 tiles at a time with shifts and ANDs.
+  // Neighbours are addressed the same way as getValueByCoord (flat index, anything outside the map counts as set).
+  void calculateBitmasks(const std::vector<uint8_t>& vec, uint8_t flag, int mapWidth, size_t first, size_t last, uint8_t* out);
+
+  // threadCount <= 0 uses every hardware thread, the generated world is identical for any thread count
+  WorldData GenerateGameWorld(const std::string& terrainPath, uint32_t seed, int mapWidth, int mapHeight, int threadCount = 0);
+  // Same, into a freshly constructed worldData of the wanted size
+  void GenerateGameWorld(WorldData& worldData, uint32_t seed, int threadCount = 0);
+
+  std::vector<float> GenerateHeightmap(uint32_t seed, int mapWidth, int mapHeight, int threadCount = 0);
+
+  // Heightmap squashed to elevation levels 0 (water) to 4 (highest mountains), without materializing the float map
+  std::vector<uint8_t> GenerateElevationLevels(uint32_t seed, int mapWidth, int mapHeight, int threadCount = 0);
+  std::vector<uint8_t> GenerateFeatureMap(uint32_t seed, const std::vector<uint8_t>& levels, int mapWidth, int mapHeight, int threadCount = 0);
+  void CreateTileMap(WorldData& worldData, uint32_t seed, int threadCount = 0);
 }
 
 #endif //KINGDOM_WORLD_GENERATOR_H
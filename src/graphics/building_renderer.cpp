@@ -0,0 +1,89 @@
+#include "building_renderer.h"
+#include "../content/file_handler.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+BuildingRenderer::BuildingRenderer(const TileSheet& tilesheet, const TileAnimationTexture& animations)
+  : tilesheet(tilesheet), animations(animations), bufferCapacity(0)
+{
+  shaderProgram.LoadShaderSources(
+      ReadTextFile("content/shaders/tileInstancedVS.glsl"),
+      ReadTextFile("content/shaders/texturedFS.glsl")
+  );
+
+  shaderProgram.Use();
+  shaderProgram.SetUniform("model", glm::mat4(1.f));
+  shaderProgram.SetUniform("tileSize", tilesheet.TileSize());
+  shaderProgram.SetUniform("sheetColumns", tilesheet.Width());
+  shaderProgram.SetUniform("sheetRows", tilesheet.Height());
+  shaderProgram.SetUniform("animLookup", 1);
+
+  // Same layout as an instanced TileMap
+  vertexBuffer.Bind();
+  vertexBuffer.EnableVertexAttribute(0);
+  vertexBuffer.EnableVertexAttribute(1);
+  vertexBuffer.EnableVertexAttribute(2);
+  vertexBuffer.VertexAttribIPointer(0, 2, GL_UNSIGNED_SHORT, sizeof(TileInstance), (GLvoid*)offsetof(TileInstance, x));
+  vertexBuffer.VertexAttribIPointer(1, 2, GL_UNSIGNED_BYTE, sizeof(TileInstance), (GLvoid*)offsetof(TileInstance, layer));
+  vertexBuffer.VertexAttribIPointer(2, 1, GL_UNSIGNED_SHORT, sizeof(TileInstance), (GLvoid*)offsetof(TileInstance, tile));
+  vertexBuffer.VertexAttribDivisor(0, 1);
+  vertexBuffer.VertexAttribDivisor(1, 1);
+  vertexBuffer.VertexAttribDivisor(2, 1);
+  vertexBuffer.Unbind();
+}
+
+void BuildingRenderer::Update(const std::vector<TileInstance>& buildings) {
+  // Mark runs of changed instances, removals only shrink the draw count
+  const size_t common = std::min(instances.size(), buildings.size());
+  size_t i = 0;
+  while (i < common) {
+    if (std::memcmp(&instances[i], &buildings[i], sizeof(TileInstance)) == 0) {
+      i++;
+      continue;
+    }
+    const size_t first = i;
+    while (i < common && std::memcmp(&instances[i], &buildings[i], sizeof(TileInstance)) != 0) i++;
+    vertexBuffer.MarkDirty(first * sizeof(TileInstance), (i - first) * sizeof(TileInstance));
+  }
+  if (buildings.size() > common) {
+    vertexBuffer.MarkDirty(common * sizeof(TileInstance), (buildings.size() - common) * sizeof(TileInstance));
+  }
+
+  instances = buildings;
+}
+
+void BuildingRenderer::upload() {
+  vertexBuffer.Bind();
+
+  // Grow by doubling, the new storage starts undefined so everything goes up again
+  if (instances.size() > bufferCapacity) {
+    bufferCapacity = std::max(instances.size(), bufferCapacity * 2);
+    vertexBuffer.SetBufferData(nullptr, bufferCapacity * sizeof(TileInstance), GL_DYNAMIC_DRAW);
+    vertexBuffer.MarkDirty(0, instances.size() * sizeof(TileInstance));
+  }
+
+  vertexBuffer.UploadDirty(instances.data(), instances.size() * sizeof(TileInstance));
+}
+
+size_t BuildingRenderer::BuildingCount() const {
+  return instances.size();
+}
+
+void BuildingRenderer::Draw(const glm::mat4& proj, const glm::mat4& view, int animFrame) {
+  upload();
+  if (instances.empty()) {
+    vertexBuffer.Unbind();
+    return;
+  }
+
+  shaderProgram.Use();
+  shaderProgram.SetUniform("proj", proj);
+  shaderProgram.SetUniform("view", view);
+  shaderProgram.SetUniform("animFrame", animFrame);
+  tilesheet.Bind();
+  animations.Bind(1);
+
+  glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, GLsizei(instances.size()));
+  vertexBuffer.Unbind();
+}
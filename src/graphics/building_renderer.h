@@ -0,0 +1,39 @@
+#ifndef KINGDOM_BUILDING_RENDERER_H
+#define KINGDOM_BUILDING_RENDERER_H
+
+#include <vector>
+#include "glm/glm.hpp"
+#include "shader_program.h"
+#include "vertex_buffer.h"
+#include "tile_sheet.h"
+#include "tile_animation.h"
+#include "../core/tile_instance.h"
+
+// Draws building TileInstances of the tile sheet in one instanced call. Update takes the current instances (see
+// BuildingInstances) and uploads only the instances that differ from the previous call, so a frame without changes
+// uploads nothing no matter how many buildings there are.
+class BuildingRenderer {
+  const TileSheet& tilesheet;
+  const TileAnimationTexture& animations;
+
+  ShaderProgram shaderProgram;
+  VertexBuffer vertexBuffer;
+  size_t bufferCapacity; // in instances
+
+  std::vector<TileInstance> instances; // CPU copy of the buffer
+
+  void upload();
+
+public:
+  BuildingRenderer(const TileSheet& tilesheet, const TileAnimationTexture& animations);
+
+  BuildingRenderer(const BuildingRenderer&) = delete;
+  BuildingRenderer& operator=(const BuildingRenderer&) = delete;
+
+  void Update(const std::vector<TileInstance>& buildings);
+
+  size_t BuildingCount() const;
+  void Draw(const glm::mat4& proj, const glm::mat4& view, int animFrame);
+};
+
+#endif //KINGDOM_BUILDING_RENDERER_H
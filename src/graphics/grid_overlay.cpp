@@ -0,0 +1,40 @@
+#include "grid_overlay.h"
+#include "glm/gtc/matrix_transform.hpp"
+#include "../content/file_handler.h"
+
+GridOverlay::GridOverlay(const int bufferWidth, const int bufferHeight) {
+  shaderProgram.LoadShaderSources(
+      ReadTextFile("content/shaders/gridVS.glsl"),
+      ReadTextFile("content/shaders/gridFS.glsl")
+  );
+
+  Resize(bufferWidth, bufferHeight);
+  SetLineColor(glm::vec4(0.f, 0.f, 0.f, 0.25f));
+  SetLineWidth(1.f);
+}
+
+void GridOverlay::Resize(const int bufferWidth, const int bufferHeight) {
+  shaderProgram.Use();
+  shaderProgram.SetUniform("proj", glm::ortho(0.f, float(bufferWidth), float(bufferHeight), 0.f, -1.f, 1.f));
+}
+
+void GridOverlay::SetLineColor(const glm::vec4& color) {
+  shaderProgram.Use();
+  shaderProgram.SetUniform("lineColor", color);
+}
+
+void GridOverlay::SetLineWidth(const float width) {
+  shaderProgram.Use();
+  shaderProgram.SetUniform("lineWidth", width);
+}
+
+void GridOverlay::Draw(const glm::mat4& view, const glm::vec2& size, const float cellSize) {
+  shaderProgram.Use();
+  shaderProgram.SetUniform("view", view);
+  shaderProgram.SetUniform("gridSize", size);
+  shaderProgram.SetUniform("cellSize", cellSize);
+
+  vertexBuffer.Bind();
+  glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  vertexBuffer.Unbind();
+}
@@ -0,0 +1,26 @@
+#ifndef KINGDOM_GRID_OVERLAY_H
+#define KINGDOM_GRID_OVERLAY_H
+
+#include "glm/glm.hpp"
+#include "shader_program.h"
+#include "vertex_buffer.h"
+
+// Tile grid drawn procedurally over the map, lines are computed in gridFS.glsl from world coordinates so they
+// stay the same width in screen pixels at any zoom
+class GridOverlay {
+  ShaderProgram shaderProgram;
+  VertexBuffer vertexBuffer; // no attributes, the quad comes from gl_VertexID
+
+public:
+  GridOverlay(int bufferWidth, int bufferHeight);
+
+  void Resize(int bufferWidth, int bufferHeight);
+  void SetLineColor(const glm::vec4& color);
+  /// Width in screen pixels
+  void SetLineWidth(float width);
+
+  /// Draws a grid of cellSize cells over [0, size) in world space, view maps world to screen like the tile map's
+  void Draw(const glm::mat4& view, const glm::vec2& size, float cellSize);
+};
+
+#endif //KINGDOM_GRID_OVERLAY_H
@@ -92,6 +92,12 @@ void ShaderProgram::LoadShaderSources(const char *vSource, const char *fSource)
 void ShaderProgram::SetUniform(const char *name, bool value) {
   glUniform1i(GetUniformLocation(name), value);
 }
+void ShaderProgram::SetUniform(const char *name, int value) {
+  glUniform1i(GetUniformLocation(name), value);
+}
+void ShaderProgram::SetUniform(const char *name, float value) {
+  glUniform1f(GetUniformLocation(name), value);
+}
 void ShaderProgram::SetUniform(const char *name, const glm::vec2 &value) {
   glUniform2f(GetUniformLocation(name), value.x, value.y);
 }
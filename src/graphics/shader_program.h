@@ -21,6 +21,8 @@ public:
   void LoadShaderSources(const char* vSource, const char* fSource) const;
 
   void SetUniform(const char* name, bool value);
+  void SetUniform(const char* name, int value);
+  void SetUniform(const char* name, float value);
   void SetUniform(const char* name, const glm::vec2 &value);
   void SetUniform(const char* name, const glm::vec3 &value);
   void SetUniform(const char* name, const glm::vec4 &value);
@@ -1,79 +1,137 @@
 #include "sprite_batch.h"
 #include "glm/gtc/matrix_transform.hpp"
 #include "../content/file_handler.h"
+#include <algorithm>
+#include <cstddef>
+#include <functional>
 
-SpriteBatch::SpriteBatch(const int bufferWidth, const int bufferHeight) {
+namespace {
+  uint32_t packColor(const glm::vec4& color) {
+    const auto c = glm::uvec4(glm::clamp(color, 0.f, 1.f) * 255.f + 0.5f);
+    return c.r | (c.g << 8) | (c.b << 16) | (c.a << 24);
+  }
+
+  // The two triangles of a quad, as indices into Sprite::corners
+  const int quadCorners[6] = { 0, 2, 1, 1, 2, 3 };
+}
+
+SpriteBatch::SpriteBatch(const int bufferWidth, const int bufferHeight)
+  : bufferCapacity(0), spriteCount(0), drawCalls(0)
+{
   // Load shaders from files and initialize ShaderProgram
-  const char* vShaderSource = ReadTextFile("content/shaders/texturedVS.glsl");
-  const char* fShaderSource = ReadTextFile("content/shaders/texturedFS.glsl");
+  const char* vShaderSource = ReadTextFile("content/shaders/spriteVS.glsl");
+  const char* fShaderSource = ReadTextFile("content/shaders/spriteFS.glsl");
   shaderProgram.LoadShaderSources(vShaderSource, fShaderSource);
 
-  // Setup VertexBuffer
+  // Setup VertexBuffer, the data itself is streamed in every End
   vertexBuffer.Bind();
 
-  float buffer[] = {
-    // POS      UV
-    0.f, 0.f,   0.f, 0.f,
-    0.f, 1.f,   0.f, 1.f,
-    1.f, 0.f,   1.f, 0.f,
-    1.f, 0.f,   1.f, 0.f,
-    0.f, 1.f,   0.f, 1.f,
-    1.f, 1.f,   1.f, 1.f,
-  };
-  vertexBuffer.SetBufferData(buffer, sizeof(buffer));
-
   vertexBuffer.EnableVertexAttribute(0); // Position
   vertexBuffer.EnableVertexAttribute(1); // UV
+  vertexBuffer.EnableVertexAttribute(2); // Tint
 
-  vertexBuffer.VertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (GLvoid*)0);
-  vertexBuffer.VertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (GLvoid*)(2 * sizeof(float)));
+  vertexBuffer.VertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (GLvoid*)offsetof(SpriteVertex, pos));
+  vertexBuffer.VertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(SpriteVertex), (GLvoid*)offsetof(SpriteVertex, uv));
+  vertexBuffer.VertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(SpriteVertex), (GLvoid*)offsetof(SpriteVertex, tint));
 
   vertexBuffer.Unbind();
 
-  // Matrix uniforms setup
-  glm::mat4 proj, view, model;
-  proj = glm::ortho(0.f, float(bufferWidth), float(bufferHeight), 0.f, -1.f, 1.f);
-  view = glm::mat4(1.f);
-  model = glm::mat4(1.f);
-
-  shaderProgram.Use();
-  shaderProgram.SetUniform("proj", proj);
-  shaderProgram.SetUniform("view", view);
-  shaderProgram.SetUniform("model", model);
+  Resize(bufferWidth, bufferHeight);
 }
 
 // Private methods
-void SpriteBatch::draw(const Texture2D &texture, const glm::mat4 &model) {
-  shaderProgram.SetUniform("model", model);
-  glDrawArrays(GL_TRIANGLES, 0, 6);
+void SpriteBatch::draw(const Texture2D &texture, const glm::mat4 &model, const glm::vec4& uvRect, const glm::vec4& tint, int layer) {
+  const uint32_t color = packColor(tint);
+
+  Sprite sprite{ &texture, layer, {} };
+  for (int i = 0; i < 4; i++) {
+    const auto corner = glm::vec2(float(i & 1), float(i >> 1));
+    sprite.corners[i] = SpriteVertex{
+        glm::vec2(model * glm::vec4(corner, 0.f, 1.f)),
+        glm::mix(glm::vec2(uvRect.x, uvRect.y), glm::vec2(uvRect.z, uvRect.w), corner),
+        color
+    };
+  }
+  sprites.push_back(sprite);
+}
+
+void SpriteBatch::flush() {
+  spriteCount = sprites.size();
+  drawCalls = 0;
+  if (sprites.empty()) return;
+
+  // Layer first, then texture, stable so sprites sharing both keep their submission order
+  order.resize(sprites.size());
+  for (uint32_t i = 0; i < order.size(); i++) order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+    if (sprites[a].layer != sprites[b].layer) return sprites[a].layer < sprites[b].layer;
+    return std::less<const Texture2D*>()(sprites[a].texture, sprites[b].texture);
+  });
+
+  vertices.resize(sprites.size() * 6);
+  SpriteVertex* out = vertices.data();
+  for (auto index : order) {
+    for (auto corner : quadCorners) *out++ = sprites[index].corners[corner];
+  }
+
+  // Grow the GPU buffer when needed, otherwise orphan it so the driver doesn't wait on the previous frame
+  const size_t bytes = vertices.size() * sizeof(SpriteVertex);
+  bufferCapacity = std::max(bufferCapacity, vertices.size());
+  vertexBuffer.SetBufferData(nullptr, bufferCapacity * sizeof(SpriteVertex), GL_STREAM_DRAW);
+  vertexBuffer.UpdateBufferData(vertices.data(), 0, bytes);
+
+  size_t first = 0;
+  for (size_t i = 1; i <= order.size(); i++) {
+    const Texture2D* texture = sprites[order[first]].texture;
+    if (i < order.size() && sprites[order[i]].texture == texture) continue;
+
+    texture->Bind();
+    glDrawArrays(GL_TRIANGLES, GLint(first * 6), GLsizei((i - first) * 6));
+    drawCalls++;
+    first = i;
+  }
+
+  sprites.clear();
 }
 
 // Public methods
-void SpriteBatch::Resize(const int bufferWidth, const int bufferHeight) { }
+void SpriteBatch::Resize(const int bufferWidth, const int bufferHeight) {
+  const auto proj = glm::ortho(0.f, float(bufferWidth), float(bufferHeight), 0.f, -1.f, 1.f);
 
-void SpriteBatch::Begin(const Texture2D& texture) const {
   shaderProgram.Use();
-  texture.Bind();
-  vertexBuffer.Bind();
+  shaderProgram.SetUniform("proj", proj);
+}
+
+void SpriteBatch::Begin(const glm::mat4& view) {
+  shaderProgram.Use();
+  shaderProgram.SetUniform("view", view);
+  sprites.clear();
 }
-void SpriteBatch::End() const {
+void SpriteBatch::End() {
+  shaderProgram.Use();
+  vertexBuffer.Bind();
+  flush();
   vertexBuffer.Unbind();
 }
 
-void SpriteBatch::Draw(const Texture2D &texture, const glm::mat4 &model) {
-  draw(texture, model);
+void SpriteBatch::Draw(const Texture2D &texture, const glm::mat4 &model, const glm::vec4& uvRect, const glm::vec4& tint, int layer) {
+  draw(texture, model, uvRect, tint, layer);
 }
 void SpriteBatch::Draw(const Texture2D &texture, const glm::vec2 &pos) {
-  glm::mat4 model = glm::translate(glm::mat4(1.f), glm::vec3(pos, 0.f));
-  model = glm::scale(model, glm::vec3(texture.Width(), texture.Height(), 1.f));
-
-  draw(texture, model);
+  Draw(texture, pos, glm::vec2(1.f));
 }
-void SpriteBatch::Draw(const Texture2D &texture, const glm::vec2 &pos, const glm::vec2 &scale) {
+void SpriteBatch::Draw(const Texture2D &texture, const glm::vec2 &pos, const glm::vec2 &scale, const glm::vec4& tint, int layer) {
   glm::mat4 model = glm::translate(glm::mat4(1.f), glm::vec3(pos, 0.f));
   model = glm::scale(model, glm::vec3(texture.Width(), texture.Height(), 1.f) * glm::vec3(scale, 1.f));
 
-  draw(texture, model);
+  draw(texture, model, glm::vec4(0.f, 0.f, 1.f, 1.f), tint, layer);
+}
+
+size_t SpriteBatch::SpriteCount() const {
+  return spriteCount;
+}
+int SpriteBatch::DrawCalls() const {
+  return drawCalls;
 }
 
 ShaderProgram &SpriteBatch::GetShaderProgram() {
@@ -2,28 +2,61 @@
 #define KINGDOM_SPRITE_BATCH_H
 
 #include <cstdint>
+#include <vector>
 #include "texture_2d.h"
 #include "shader_program.h"
 #include "glm/glm.hpp"
 #include "vertex_buffer.h"
 
+struct SpriteVertex {
+  glm::vec2 pos;
+  glm::vec2 uv;
+  uint32_t tint; // RGBA8, read as a normalized vec4
+};
+
+// Collects sprites between Begin and End and draws them in as few calls as possible. Sprites are ordered by
+// layer, then grouped by texture (keeping submission order within a group) and drawn with one call per texture switch.
 class SpriteBatch {
+  struct Sprite {
+    const Texture2D* texture;
+    int layer;
+    SpriteVertex corners[4]; // top left, top right, bottom left, bottom right
+  };
+
   ShaderProgram shaderProgram;
   VertexBuffer vertexBuffer;
 
-  void draw(const Texture2D& texture, const glm::mat4& model);
+  std::vector<Sprite> sprites;
+  std::vector<uint32_t> order;
+  std::vector<SpriteVertex> vertices;
+  size_t bufferCapacity; // in vertices
+
+  // stats of the last End
+  size_t spriteCount;
+  int drawCalls;
+
+  void draw(const Texture2D& texture, const glm::mat4& model, const glm::vec4& uvRect, const glm::vec4& tint, int layer);
+  void flush();
 
 public:
   SpriteBatch(int bufferWidth, int bufferHeight);
 
   void Resize(int bufferWidth, int bufferHeight);
 
-  void Begin(const Texture2D& texture) const;
-  void End() const;
+  /// view transforms every sprite of the batch, e.g. the camera for sprites placed in the world
+  void Begin(const glm::mat4& view = glm::mat4(1.f));
+  void End();
 
-  void Draw(const Texture2D& texture, const glm::mat4& model);
+  /// model maps the unit square onto the screen, uvRect is (u0, v0, u1, v1)
+  void Draw(const Texture2D& texture, const glm::mat4& model,
+            const glm::vec4& uvRect = glm::vec4(0.f, 0.f, 1.f, 1.f), const glm::vec4& tint = glm::vec4(1.f), int layer = 0);
   void Draw(const Texture2D& texture, const glm::vec2& pos);
-  void Draw(const Texture2D& texture, const glm::vec2& pos, const glm::vec2& scale);
+  void Draw(const Texture2D& texture, const glm::vec2& pos, const glm::vec2& scale,
+            const glm::vec4& tint = glm::vec4(1.f), int layer = 0);
+
+  /// Sprites and draw calls of the last End
+  size_t SpriteCount() const;
+  int DrawCalls() const;
 
   ShaderProgram& GetShaderProgram();
 };
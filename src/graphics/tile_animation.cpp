@@ -0,0 +1,47 @@
+#include "tile_animation.h"
+#include "glad/glad.h"
+#include "spdlog/spdlog.h"
+#include <vector>
+
+TileAnimationTexture::TileAnimationTexture(const AnimTable& animTable, int tileCount)
+  : tileCount(tileCount)
+{
+  std::vector<uint16_t> frames(size_t(tileCount) * 4);
+  for (int tile = 0; tile < tileCount; tile++) {
+    for (int frame = 0; frame < 4; frame++) frames[tile * 4 + frame] = uint16_t(tile);
+  }
+
+  for (const auto& [tile, animation] : animTable) {
+    if (tile < 0 || tile >= tileCount) {
+      spdlog::error("Animated tile {} is outside of the tile sheet ({} tiles)", tile, tileCount);
+      continue;
+    }
+    for (int frame = 0; frame < 4; frame++) frames[tile * 4 + frame] = uint16_t(animation[frame]);
+  }
+
+  glGenTextures(1, &id);
+  glBindTexture(GL_TEXTURE_2D, id);
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16UI, tileCount, 1, 0, GL_RGBA_INTEGER, GL_UNSIGNED_SHORT, frames.data());
+
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+TileAnimationTexture::~TileAnimationTexture() {
+  glDeleteTextures(1, &id);
+}
+
+int TileAnimationTexture::TileCount() const {
+  return tileCount;
+}
+
+void TileAnimationTexture::Bind(int unit) const {
+  glActiveTexture(GL_TEXTURE0 + unit);
+  glBindTexture(GL_TEXTURE_2D, id);
+  glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,21 @@
+#ifndef KINGDOM_TILE_ANIMATION_H
+#define KINGDOM_TILE_ANIMATION_H
+
+#include <cstdint>
+#include "tile_sheet.h"
+
+// GPU copy of an AnimTable, read by tileInstancedVS.glsl. Texel t of the RGBA16UI lookup holds the 4 frames
+// of tile t, tiles without an animation map to themselves so the shader never has to branch.
+class TileAnimationTexture {
+  uint32_t id;
+  int tileCount;
+
+public:
+  TileAnimationTexture(const AnimTable& animTable, int tileCount);
+  ~TileAnimationTexture();
+
+  int TileCount() const;
+  void Bind(int unit) const;
+};
+
+#endif //KINGDOM_TILE_ANIMATION_H
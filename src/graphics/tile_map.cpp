@@ -1,154 +1,284 @@
 #include "tile_map.h"
-#include "glm/glm.hpp"
+#include "tile_mesh.h"
+#include "../math/parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
 
-const int AttributeCount = 30;
+// Chunk capacities are rounded up past their tile count to this many tiles, so edits that add tiles rarely
+// have to move chunks around
+const size_t chunkSlack = 64;
 
-TileMap::TileMap(int mapWidth, int mapHeight, int tileCount)
-  : mapWidth(mapWidth), mapHeight(mapHeight), tileCount(tileCount)
-{
-  bufferData = new float[tileCount * AttributeCount];
+namespace {
+  // Points the instance attributes at firstInstance, GL 4.0 has no base instance for instanced draws
+  void setInstanceAttributes(const VertexBuffer& vertexBuffer, size_t firstInstance) {
+    const size_t base = firstInstance * sizeof(TileInstance);
+    vertexBuffer.VertexAttribute(0, 2, GL_UNSIGNED_SHORT, AttribFormat::Integer, sizeof(TileInstance), base + offsetof(TileInstance, x));
+    vertexBuffer.VertexAttribute(1, 2, GL_UNSIGNED_BYTE, AttribFormat::Integer, sizeof(TileInstance), base + offsetof(TileInstance, layer));
+    vertexBuffer.VertexAttribute(2, 1, GL_UNSIGNED_SHORT, AttribFormat::Integer, sizeof(TileInstance), base + offsetof(TileInstance, tile));
+  }
+}
 
+TileRect VisibleTileRect(const glm::mat4& camera, float viewportWidth, float viewportHeight, int tileSize) {
+  const glm::mat4 screenToWorld = glm::inverse(camera);
+  const glm::vec2 corners[] = {
+      glm::vec2(screenToWorld * glm::vec4(0.f, 0.f, 0.f, 1.f)),
+      glm::vec2(screenToWorld * glm::vec4(viewportWidth, 0.f, 0.f, 1.f)),
+      glm::vec2(screenToWorld * glm::vec4(0.f, viewportHeight, 0.f, 1.f)),
+      glm::vec2(screenToWorld * glm::vec4(viewportWidth, viewportHeight, 0.f, 1.f))
+  };
+
+  glm::vec2 low = corners[0], high = corners[0];
+  for (const auto& corner : corners) {
+    low = glm::min(low, corner);
+    high = glm::max(high, corner);
+  }
+
+  return TileRect{
+      int(glm::floor(low.x / float(tileSize))), int(glm::floor(low.y / float(tileSize))),
+      int(glm::ceil(high.x / float(tileSize))), int(glm::ceil(high.y / float(tileSize)))
+  };
+}
+
+TileMap::TileMap(int mapWidth, int mapHeight, TileMapMode mode, int threadCount)
+  : mapWidth(mapWidth), mapHeight(mapHeight), tileCount(0), mode(mode), threadCount(threadCount),
+    vertexData(nullptr), instanceData(nullptr),
+    chunksX(TileChunkCount(mapWidth)), chunksY(TileChunkCount(mapHeight)),
+    dirtyChunks(size_t(chunksX) * chunksY, 0)
+{
   vertexBuffer.Bind();
-  vertexBuffer.SetBufferData(bufferData, sizeof(float) * tileCount * AttributeCount, GL_DYNAMIC_DRAW);
-  vertexBuffer.EnableVertexAttribute(0);
-  vertexBuffer.EnableVertexAttribute(1);
-  vertexBuffer.VertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (GLvoid*)0);
-  vertexBuffer.VertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (GLvoid*)(3 * sizeof(float)));
+
+  if (mode == TileMapMode::Instanced) {
+    // x, y | layer, flags | tile, the unit quad itself comes from gl_VertexID
+    setInstanceAttributes(vertexBuffer, 0);
+    vertexBuffer.VertexAttribDivisor(0, 1);
+    vertexBuffer.VertexAttribDivisor(1, 1);
+    vertexBuffer.VertexAttribDivisor(2, 1);
+  } else {
+    // x, y | layer, corner | tile
+    vertexBuffer.VertexAttribute(0, 2, GL_SHORT, AttribFormat::Float, sizeof(TileVertex), offsetof(TileVertex, x));
+    vertexBuffer.VertexAttribute(1, 2, GL_UNSIGNED_BYTE, AttribFormat::Integer, sizeof(TileVertex), offsetof(TileVertex, layer));
+    vertexBuffer.VertexAttribute(2, 1, GL_UNSIGNED_SHORT, AttribFormat::Integer, sizeof(TileVertex), offsetof(TileVertex, tile));
+  }
+
   vertexBuffer.Unbind();
 }
 TileMap::~TileMap() {
-  delete[] bufferData;
+  delete[] vertexData;
+  delete[] instanceData;
 }
 
 void TileMap::GenerateAnimatedBuffer(const std::vector<int>& tiles,
                              const std::vector<uint8_t>& tileData,
-                             const TileSheet& tilesheet,
                              const AnimTable& animTable,
                              int animIndex) {
-  const auto tileSize = float(tilesheet.TileSize());
-  const auto sheetSize = glm::vec2(1.f / tilesheet.Width(), 1.f / tilesheet.Height());
-
-  size_t attributeCounter = 0;
-  for (size_t i = 0; i < tiles.size(); i++) {
-    auto tileIndex = tiles[i];
-    if (tileIndex == -1) continue; // -1 index represents no tile
-
-    if ((tileData[i] & uint8_t(TILE_FLAGS::Anim)) == uint8_t(TILE_FLAGS::Anim))
-      tileIndex = animTable.at(tileIndex)[animIndex];
-
-    const auto point = glm::vec2(
-      float(tileIndex % tilesheet.Width()) / tilesheet.Width(),
-      float(tileIndex / tilesheet.Width()) / tilesheet.Height()
-    );
-
-    // convert i to localized index (ignoring depth)
-    const size_t localIndex = i % (mapWidth * mapHeight);
-    const size_t x = localIndex % mapWidth;
-    const size_t y = localIndex / mapWidth;
-    const size_t z = i / (mapWidth * mapHeight);
-
-    bufferData[attributeCounter++] = x * tileSize;
-    bufferData[attributeCounter++] = y * tileSize;
-    bufferData[attributeCounter++] = z;
-    bufferData[attributeCounter++] = point.x;
-    bufferData[attributeCounter++] = point.y;
-
-    bufferData[attributeCounter++] = x * tileSize;
-    bufferData[attributeCounter++] = y * tileSize + tileSize;
-    bufferData[attributeCounter++] = z;
-    bufferData[attributeCounter++] = point.x;
-    bufferData[attributeCounter++] = point.y + sheetSize.y;
-
-    bufferData[attributeCounter++] = x * tileSize + tileSize;
-    bufferData[attributeCounter++] = y * tileSize;
-    bufferData[attributeCounter++] = z;
-    bufferData[attributeCounter++] = point.x + sheetSize.x;
-    bufferData[attributeCounter++] = point.y;
-
-
-    bufferData[attributeCounter++] = x * tileSize + tileSize;
-    bufferData[attributeCounter++] = y * tileSize;
-    bufferData[attributeCounter++] = z;
-    bufferData[attributeCounter++] = point.x + sheetSize.x;
-    bufferData[attributeCounter++] = point.y;
-
-    bufferData[attributeCounter++] = x * tileSize;
-    bufferData[attributeCounter++] = y * tileSize + tileSize;
-    bufferData[attributeCounter++] = z;
-    bufferData[attributeCounter++] = point.x;
-    bufferData[attributeCounter++] = point.y + sheetSize.y;
-
-    bufferData[attributeCounter++] = x * tileSize + tileSize;
-    bufferData[attributeCounter++] = y * tileSize + tileSize;
-    bufferData[attributeCounter++] = z;
-    bufferData[attributeCounter++] = point.x + sheetSize.x;
-    bufferData[attributeCounter++] = point.y + sheetSize.y;
+  updateChunks(TileSource{ tiles, &tileData, &animTable, animIndex }, true);
+}
+
+void TileMap::GenerateBuffer(const std::vector<int> &tiles) {
+  updateChunks(TileSource{ tiles, nullptr, nullptr, 0 }, true);
+}
+
+void TileMap::MarkDirty(int x, int y) {
+  MarkDirty(TileRect{ x, y, x + 1, y + 1 });
+}
+
+void TileMap::MarkDirty(const TileRect& tiles) {
+  const int firstX = std::max(tiles.x0, 0) / TileChunkSize;
+  const int firstY = std::max(tiles.y0, 0) / TileChunkSize;
+  const int lastX = std::min(TileChunkCount(std::max(tiles.x1, 0)), chunksX);
+  const int lastY = std::min(TileChunkCount(std::max(tiles.y1, 0)), chunksY);
+
+  for (int chunkY = firstY; chunkY < lastY; chunkY++) {
+    for (int chunkX = firstX; chunkX < lastX; chunkX++) dirtyChunks[size_t(chunkY) * chunksX + chunkX] = 1;
+  }
+}
+
+size_t TileMap::UpdateDirty(const std::vector<int>& tiles,
+                            const std::vector<uint8_t>& tileData,
+                            const AnimTable& animTable,
+                            int animIndex) {
+  // Instanced maps animate in the shader, their instances always hold the base tile
+  const auto source = mode == TileMapMode::Instanced
+      ? TileSource{ tiles, nullptr, nullptr, 0 }
+      : TileSource{ tiles, &tileData, &animTable, animIndex };
+  return updateChunks(source, false);
+}
+
+size_t TileMap::updateChunks(const TileSource& source, bool allChunks) {
+  if (chunks.empty()) {
+    layoutChunks(source.tiles);
+    allChunks = true;
+  }
+
+  const size_t stride = elementSize();
+  const size_t depth = source.tiles.size() / (size_t(mapWidth) * mapHeight);
+  auto* data = bufferBytes();
+
+  // Small edits are cheaper to re-encode than to start threads for
+  const size_t dirtyCount = allChunks ? chunks.size() : size_t(std::count(dirtyChunks.begin(), dirtyChunks.end(), 1));
+  const int threads = dirtyCount > size_t(chunksX) ? threadCount : 1;
+
+  // Bands of chunk rows are encoded in parallel, chunks never share bytes so each band copies into its own slots
+  // and keeps its dirty ranges to itself until the join
+  std::vector<std::vector<std::pair<size_t, size_t>>> bandRanges(size_t(std::min(chunksY, ResolveThreadCount(threads))));
+  std::atomic<bool> outOfRoom(false);
+  ForEachRowBand(chunksY, threads, [&](int firstChunkRow, int lastChunkRow, int band) {
+    std::vector<uint8_t> scratch(size_t(TileChunkSize) * TileChunkSize * depth * stride);
+
+    for (int chunkY = firstChunkRow; chunkY < lastChunkRow && !outOfRoom; chunkY++) {
+      for (int chunkX = 0; chunkX < chunksX; chunkX++) {
+        const size_t chunkIndex = size_t(chunkY) * chunksX + chunkX;
+        if (!allChunks && !dirtyChunks[chunkIndex]) continue;
+        dirtyChunks[chunkIndex] = 0;
+
+        auto& chunk = chunks[chunkIndex];
+        const size_t count = encodeChunk(source, TileChunkRect(chunkX, chunkY, mapWidth, mapHeight), scratch.data());
+        if (count > chunk.capacity) {
+          outOfRoom = true;
+          return;
+        }
+
+        writePadding(scratch.data() + count * stride, chunk.capacity - count);
+        chunk.count = count;
+
+        // Only the bytes that differ from the previous encoding go to the GPU
+        uint8_t* slot = data + chunk.first * stride;
+        const size_t size = chunk.capacity * stride;
+        size_t begin = 0, end = size;
+        while (begin < end && slot[begin] == scratch[begin]) begin++;
+        while (end > begin && slot[end - 1] == scratch[end - 1]) end--;
+        if (begin == end) continue;
+
+        std::copy(scratch.begin() + begin, scratch.begin() + end, slot + begin);
+        bandRanges[band].emplace_back(chunk.first * stride + begin, end - begin);
+      }
+    }
+  });
+
+  if (outOfRoom) {
+    // A chunk outgrew its padding, lay the whole buffer out again
+    layoutChunks(source.tiles);
+    return updateChunks(source, true);
+  }
+
+  for (const auto& ranges : bandRanges) {
+    for (const auto& range : ranges) vertexBuffer.MarkDirty(range.first, range.second);
   }
 
   vertexBuffer.Bind();
-  vertexBuffer.UpdateBufferData(bufferData, 0, sizeof(float) * tileCount * 30);
+  const size_t uploaded = vertexBuffer.UploadDirty(data, BufferSize());
   vertexBuffer.Unbind();
+  return uploaded;
 }
 
-void TileMap::GenerateBuffer(const std::vector<int> &tiles, const TileSheet &tilesheet) {
-  const auto tileSize = float(tilesheet.TileSize());
-  const auto sheetSize = glm::vec2(1.f / tilesheet.Width(), 1.f / tilesheet.Height());
-
-  size_t attributeCounter = 0;
-  for (size_t i = 0; i < tiles.size(); i++) {
-    auto tileIndex = tiles[i];
-    if (tileIndex == -1) continue; // -1 index represents no tile
-
-    const auto point = glm::vec2(
-        float(tileIndex % tilesheet.Width()) / tilesheet.Width(),
-        float(tileIndex / tilesheet.Width()) / tilesheet.Height()
-    );
-
-    // convert i to localized index (ignoring depth)
-    const size_t localIndex = i % (mapWidth * mapHeight);
-    const size_t x = localIndex % mapWidth;
-    const size_t y = localIndex / mapWidth;
-    const size_t z = i / (mapWidth * mapHeight);
-
-    bufferData[attributeCounter++] = x * tileSize;
-    bufferData[attributeCounter++] = y * tileSize;
-    bufferData[attributeCounter++] = z;
-    bufferData[attributeCounter++] = point.x;
-    bufferData[attributeCounter++] = point.y;
-
-    bufferData[attributeCounter++] = x * tileSize;
-    bufferData[attributeCounter++] = y * tileSize + tileSize;
-    bufferData[attributeCounter++] = z;
-    bufferData[attributeCounter++] = point.x;
-    bufferData[attributeCounter++] = point.y + sheetSize.y;
-
-    bufferData[attributeCounter++] = x * tileSize + tileSize;
-    bufferData[attributeCounter++] = y * tileSize;
-    bufferData[attributeCounter++] = z;
-    bufferData[attributeCounter++] = point.x + sheetSize.x;
-    bufferData[attributeCounter++] = point.y;
-
-
-    bufferData[attributeCounter++] = x * tileSize + tileSize;
-    bufferData[attributeCounter++] = y * tileSize;
-    bufferData[attributeCounter++] = z;
-    bufferData[attributeCounter++] = point.x + sheetSize.x;
-    bufferData[attributeCounter++] = point.y;
-
-    bufferData[attributeCounter++] = x * tileSize;
-    bufferData[attributeCounter++] = y * tileSize + tileSize;
-    bufferData[attributeCounter++] = z;
-    bufferData[attributeCounter++] = point.x;
-    bufferData[attributeCounter++] = point.y + sheetSize.y;
-
-    bufferData[attributeCounter++] = x * tileSize + tileSize;
-    bufferData[attributeCounter++] = y * tileSize + tileSize;
-    bufferData[attributeCounter++] = z;
-    bufferData[attributeCounter++] = point.x + sheetSize.x;
-    bufferData[attributeCounter++] = point.y + sheetSize.y;
+void TileMap::layoutChunks(const std::vector<int>& tiles) {
+  chunks = BuildTileChunks(tiles, mapWidth, mapHeight, threadCount);
+
+  size_t slots = 0;
+  for (auto& chunk : chunks) {
+    chunk.first = slots;
+    chunk.capacity = (chunk.count + chunkSlack) / chunkSlack * chunkSlack;
+    slots += chunk.capacity;
   }
 
+  delete[] vertexData;
+  delete[] instanceData;
+  vertexData = nullptr;
+  instanceData = nullptr;
+
+  tileCount = int(slots);
+  if (mode == TileMapMode::Instanced) instanceData = new TileInstance[slots];
+  else vertexData = new TileVertex[slots * TileVerticesPerTile];
+
+  // Everything starts out as padding and gets uploaded once the chunks are encoded
+  writePadding(bufferBytes(), slots);
   vertexBuffer.Bind();
-  vertexBuffer.UpdateBufferData(bufferData, 0, sizeof(float) * tileCount * 30);
+  vertexBuffer.SetBufferData(nullptr, BufferSize(), GL_DYNAMIC_DRAW);
+  vertexBuffer.MarkDirty(0, BufferSize());
   vertexBuffer.Unbind();
 }
+
+size_t TileMap::encodeChunk(const TileSource& source, const TileRect& region, uint8_t* out) const {
+  if (mode == TileMapMode::Instanced) {
+    auto* instances = reinterpret_cast<TileInstance*>(out);
+    if (source.tileFlags == nullptr) return BuildTileInstances(source.tiles, mapWidth, mapHeight, region, instances);
+    return BuildAnimatedTileInstances(source.tiles, *source.tileFlags, *source.animTable, source.animIndex,
+                                      mapWidth, mapHeight, region, instances);
+  }
+
+  auto* vertices = reinterpret_cast<TileVertex*>(out);
+  if (source.tileFlags == nullptr) return BuildTileVertices(source.tiles, mapWidth, mapHeight, region, vertices);
+  return BuildAnimatedTileVertices(source.tiles, *source.tileFlags, *source.animTable, source.animIndex,
+                                   mapWidth, mapHeight, region, vertices);
+}
+
+void TileMap::writePadding(uint8_t* out, size_t count) const {
+  if (mode == TileMapMode::Instanced) {
+    auto* instances = reinterpret_cast<TileInstance*>(out);
+    std::fill(instances, instances + count, EncodeTileInstance(0, 0, 0, 0, TileInstanceHidden));
+  } else {
+    // Degenerate triangles, nothing gets rasterized
+    std::fill(out, out + count * elementSize(), uint8_t(0));
+  }
+}
+
+uint8_t* TileMap::bufferBytes() {
+  if (mode == TileMapMode::Instanced) return reinterpret_cast<uint8_t*>(instanceData);
+  return reinterpret_cast<uint8_t*>(vertexData);
+}
+
+size_t TileMap::elementSize() const {
+  if (mode == TileMapMode::Instanced) return sizeof(TileInstance);
+  return sizeof(TileVertex) * TileVerticesPerTile;
+}
+
+const void* TileMap::BufferData() const {
+  if (mode == TileMapMode::Instanced) return instanceData;
+  return vertexData;
+}
+
+size_t TileMap::BufferSize() const {
+  return elementSize() * tileCount;
+}
+
+const char* TileMap::VertexShaderPath() const {
+  if (mode == TileMapMode::Instanced) return "content/shaders/tileInstancedVS.glsl";
+  return "content/shaders/tileVS.glsl";
+}
+
+void TileMap::Draw() const {
+  vertexBuffer.Bind();
+  drawRange(0, tileCount);
+  vertexBuffer.Unbind();
+}
+
+void TileMap::Draw(const TileRect& visible) const {
+  if (chunks.empty()) return;
+
+  const int firstX = std::max(visible.x0, 0) / TileChunkSize;
+  const int firstY = std::max(visible.y0, 0) / TileChunkSize;
+  const int lastX = std::min(TileChunkCount(std::max(visible.x1, 0)), chunksX);
+  const int lastY = std::min(TileChunkCount(std::max(visible.y1, 0)), chunksY);
+  if (firstX >= lastX || firstY >= lastY) return;
+
+  // Chunks of one chunk row are adjacent in the buffer
+  vertexBuffer.Bind();
+  for (int chunkY = firstY; chunkY < lastY; chunkY++) {
+    const auto& first = chunks[size_t(chunkY) * chunksX + firstX];
+    const auto& last = chunks[size_t(chunkY) * chunksX + lastX - 1];
+    drawRange(first.first, last.first + last.count - first.first);
+  }
+  vertexBuffer.Unbind();
+}
+
+void TileMap::drawRange(size_t first, size_t count) const {
+  if (count == 0) return;
+
+  if (mode == TileMapMode::Instanced) {
+    setInstanceAttributes(vertexBuffer, first);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, GLsizei(count));
+  } else {
+    glDrawArrays(GL_TRIANGLES, GLint(first * TileVerticesPerTile), GLsizei(count * TileVerticesPerTile));
+  }
+}
@@ -2,26 +2,79 @@
 #define KINGDOM_TILE_MAP_H
 
 #include <vector>
+#include "glm/glm.hpp"
 #include "vertex_buffer.h"
 #include "tile_sheet.h"
+#include "tile_mesh.h"
+
+enum struct TileMapMode {
+  Vertices,  // 6 vertices of 8 bytes per tile, drawn with tileVS.glsl
+  Instanced  // one 8 byte TileInstance per tile, drawn with tileInstancedVS.glsl
+};
+
+/// Tiles covered by a viewport of the given size, where camera maps world to screen pixels
+TileRect VisibleTileRect(const glm::mat4& camera, float viewportWidth, float viewportHeight, int tileSize);
 
 struct TileMap {
   int mapWidth, mapHeight;
-  int tileCount;
+  int tileCount;  // buffer slots, the tiles of every chunk plus their padding
+  TileMapMode mode;
+  int threadCount;  // for remeshing, <= 0 uses every hardware thread
 
   VertexBuffer vertexBuffer;
-  float* bufferData;
+  TileVertex* vertexData;      // Vertices mode only
+  TileInstance* instanceData;  // Instanced mode only
 
-  TileMap(int mapWidth, int mapHeight, int tileCount);
+  int chunksX, chunksY;
+  std::vector<TileChunk> chunks;
+  std::vector<uint8_t> dirtyChunks;
+
+  TileMap(int mapWidth, int mapHeight, TileMapMode mode = TileMapMode::Instanced, int threadCount = 0);
   ~TileMap();
 
   void GenerateAnimatedBuffer(const std::vector<int>& tiles,
                               const std::vector<uint8_t>& tileData,
-                              const TileSheet& tilesheet,
                               const AnimTable& animTable,
                               int animIndex);
 
-  void GenerateBuffer(const std::vector<int>& tiles, const TileSheet& tilesheet);
+  void GenerateBuffer(const std::vector<int>& tiles);
+
+  /// Flags the chunks holding these tiles (all layers) for the next UpdateDirty
+  void MarkDirty(int x, int y);
+  void MarkDirty(const TileRect& tiles);
+  /// Re-encodes the dirty chunks and uploads only the bytes that changed, returns the number of bytes uploaded
+  size_t UpdateDirty(const std::vector<int>& tiles,
+                     const std::vector<uint8_t>& tileData,
+                     const AnimTable& animTable,
+                     int animIndex);
+
+  /// CPU copy of the GPU buffer and its size in bytes
+  const void* BufferData() const;
+  size_t BufferSize() const;
+  const char* VertexShaderPath() const;
+
+  /// Expects the matching shader program and the tile sheet to be bound, the shader reads the tile size and sheet
+  /// dimensions from the tileSize, sheetColumns and sheetRows uniforms
+  void Draw() const;
+  /// Draws only the chunks overlapping visible, one draw call per chunk row
+  void Draw(const TileRect& visible) const;
+
+private:
+  // Tiles to encode, animated when tileFlags is set
+  struct TileSource {
+    const std::vector<int>& tiles;
+    const std::vector<uint8_t>* tileFlags;
+    const AnimTable* animTable;
+    int animIndex;
+  };
+
+  size_t updateChunks(const TileSource& source, bool allChunks);
+  void layoutChunks(const std::vector<int>& tiles);
+  size_t encodeChunk(const TileSource& source, const TileRect& region, uint8_t* out) const;
+  void writePadding(uint8_t* out, size_t count) const;
+  uint8_t* bufferBytes();
+  size_t elementSize() const;
+  void drawRange(size_t first, size_t count) const;
 };
 
 #endif //KINGDOM_TILE_MAP_H
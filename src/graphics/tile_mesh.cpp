@@ -0,0 +1,168 @@
+#include "tile_mesh.h"
+#include "../math/parallel.h"
+#include <algorithm>
+
+namespace {
+  // Calls emit(x, y, z, tileIndex) for every tile of region that isn't -1, chunk by chunk and layer by layer within a chunk
+  template <typename ResolveTile, typename Emit>
+  void forEachTile(const std::vector<int>& tiles, int mapWidth, int mapHeight, const TileRect& region,
+                   const ResolveTile& resolveTile, const Emit& emit) {
+    const size_t layerSize = size_t(mapWidth) * mapHeight;
+    const int depth = int(tiles.size() / layerSize);
+
+    for (int chunkY = region.y0; chunkY < region.y1; chunkY += TileChunkSize) {
+      const int lastY = std::min(chunkY + TileChunkSize, region.y1);
+      for (int chunkX = region.x0; chunkX < region.x1; chunkX += TileChunkSize) {
+        const int lastX = std::min(chunkX + TileChunkSize, region.x1);
+
+        for (int z = 0; z < depth; z++) {
+          for (int y = chunkY; y < lastY; y++) {
+            const size_t row = z * layerSize + size_t(y) * mapWidth;
+            for (int x = chunkX; x < lastX; x++) {
+              auto tileIndex = tiles[row + x];
+              if (tileIndex == -1) continue; // -1 index represents no tile
+
+              emit(size_t(x), size_t(y), size_t(z), resolveTile(row + x, tileIndex));
+            }
+          }
+        }
+      }
+    }
+  }
+
+  template <typename ResolveTile>
+  size_t buildVertices(const std::vector<int>& tiles, int mapWidth, int mapHeight, const TileRect& region,
+                       TileVertex* out, const ResolveTile& resolveTile) {
+    // Corners of the two triangles, bit 0 right, bit 1 bottom
+    const uint8_t corners[TileVerticesPerTile] = { 0, 2, 1, 1, 2, 3 };
+
+    size_t vertexCounter = 0;
+    forEachTile(tiles, mapWidth, mapHeight, region, resolveTile, [&](size_t x, size_t y, size_t z, int tileIndex) {
+      for (auto corner : corners) {
+        out[vertexCounter++] = TileVertex{
+            int16_t(x + (corner & 1)), int16_t(y + (corner >> 1)), uint8_t(z), corner, uint16_t(tileIndex)
+        };
+      }
+    });
+
+    return vertexCounter / TileVerticesPerTile;
+  }
+
+  template <typename ResolveTile>
+  size_t buildInstances(const std::vector<int>& tiles, int mapWidth, int mapHeight, const TileRect& region,
+                        TileInstance* out, const ResolveTile& resolveTile) {
+    size_t instanceCounter = 0;
+    forEachTile(tiles, mapWidth, mapHeight, region, resolveTile, [&](size_t x, size_t y, size_t z, int tileIndex) {
+      out[instanceCounter++] = EncodeTileInstance(x, y, z, tileIndex);
+    });
+
+    return instanceCounter;
+  }
+
+  size_t countTiles(const std::vector<int>& tiles, int mapWidth, int mapHeight, const TileRect& region) {
+    const size_t layerSize = size_t(mapWidth) * mapHeight;
+
+    size_t count = 0;
+    for (size_t layer = 0; layer < tiles.size(); layer += layerSize) {
+      for (int y = region.y0; y < region.y1; y++) {
+        const int* row = tiles.data() + layer + size_t(y) * mapWidth;
+        for (int x = region.x0; x < region.x1; x++) count += row[x] != -1;
+      }
+    }
+    return count;
+  }
+
+  // Runs build(band region, first element) over bands of whole chunk rows. The tiles of every band are counted
+  // first, a prefix sum over the counts gives each band its write offset, so the output matches a serial build.
+  template <typename Build>
+  size_t buildParallel(const std::vector<int>& tiles, int mapWidth, int mapHeight, const TileRect& region,
+                       int threadCount, const Build& build) {
+    const int chunkRows = TileChunkCount(region.y1 - region.y0);
+    const auto bandRect = [&](int firstChunkRow, int lastChunkRow) {
+      return TileRect{ region.x0, region.y0 + firstChunkRow * TileChunkSize,
+                       region.x1, std::min(region.y0 + lastChunkRow * TileChunkSize, region.y1) };
+    };
+
+    if (chunkRows <= 1 || ResolveThreadCount(threadCount) <= 1) return build(region, 0);
+
+    std::vector<size_t> bandOffsets(size_t(std::min(chunkRows, ResolveThreadCount(threadCount))) + 1, 0);
+    ForEachRowBand(chunkRows, threadCount, [&](int firstChunkRow, int lastChunkRow, int band) {
+      bandOffsets[band + 1] = countTiles(tiles, mapWidth, mapHeight, bandRect(firstChunkRow, lastChunkRow));
+    });
+    for (size_t band = 1; band < bandOffsets.size(); band++) bandOffsets[band] += bandOffsets[band - 1];
+
+    ForEachRowBand(chunkRows, threadCount, [&](int firstChunkRow, int lastChunkRow, int band) {
+      build(bandRect(firstChunkRow, lastChunkRow), bandOffsets[band]);
+    });
+    return bandOffsets.back();
+  }
+
+  int staticTile(size_t, int tileIndex) {
+    return tileIndex;
+  }
+
+  // Swaps animated tiles for their current frame
+  auto animatedTile(const std::vector<uint8_t>& tileFlags, const AnimTable& animTable, int animIndex) {
+    return [&tileFlags, &animTable, animIndex](size_t i, int tileIndex) {
+      if ((tileFlags[i] & uint8_t(TILE_FLAGS::Anim)) == uint8_t(TILE_FLAGS::Anim))
+        tileIndex = animTable.at(tileIndex)[animIndex];
+      return tileIndex;
+    };
+  }
+}
+
+size_t BuildTileVertices(const std::vector<int>& tiles, int mapWidth, int mapHeight, const TileRect& region,
+                         TileVertex* out, int threadCount) {
+  return buildParallel(tiles, mapWidth, mapHeight, region, threadCount, [&](const TileRect& band, size_t first) {
+    return buildVertices(tiles, mapWidth, mapHeight, band, out + first * TileVerticesPerTile, staticTile);
+  });
+}
+
+size_t BuildAnimatedTileVertices(const std::vector<int>& tiles, const std::vector<uint8_t>& tileFlags,
+                                 const AnimTable& animTable, int animIndex,
+                                 int mapWidth, int mapHeight, const TileRect& region, TileVertex* out, int threadCount) {
+  return buildParallel(tiles, mapWidth, mapHeight, region, threadCount, [&](const TileRect& band, size_t first) {
+    return buildVertices(tiles, mapWidth, mapHeight, band, out + first * TileVerticesPerTile,
+                         animatedTile(tileFlags, animTable, animIndex));
+  });
+}
+
+size_t BuildTileInstances(const std::vector<int>& tiles, int mapWidth, int mapHeight, const TileRect& region,
+                          TileInstance* out, int threadCount) {
+  return buildParallel(tiles, mapWidth, mapHeight, region, threadCount, [&](const TileRect& band, size_t first) {
+    return buildInstances(tiles, mapWidth, mapHeight, band, out + first, staticTile);
+  });
+}
+
+size_t BuildAnimatedTileInstances(const std::vector<int>& tiles, const std::vector<uint8_t>& tileFlags,
+                                  const AnimTable& animTable, int animIndex,
+                                  int mapWidth, int mapHeight, const TileRect& region, TileInstance* out, int threadCount) {
+  return buildParallel(tiles, mapWidth, mapHeight, region, threadCount, [&](const TileRect& band, size_t first) {
+    return buildInstances(tiles, mapWidth, mapHeight, band, out + first, animatedTile(tileFlags, animTable, animIndex));
+  });
+}
+
+std::vector<TileChunk> BuildTileChunks(const std::vector<int>& tiles, int mapWidth, int mapHeight, int threadCount) {
+  const int chunksX = TileChunkCount(mapWidth);
+  const int chunksY = TileChunkCount(mapHeight);
+
+  // Count the tiles of every chunk, each band owning whole chunk rows, then turn the counts into offsets in build order
+  std::vector<TileChunk> chunks(size_t(chunksX) * chunksY, TileChunk{ 0, 0, 0 });
+  ForEachRowBand(chunksY, threadCount, [&](int firstChunkRow, int lastChunkRow, int) {
+    for (int chunkY = firstChunkRow; chunkY < lastChunkRow; chunkY++) {
+      TileChunk* chunkRow = chunks.data() + size_t(chunkY) * chunksX;
+      for (int chunkX = 0; chunkX < chunksX; chunkX++) {
+        chunkRow[chunkX].count = countTiles(tiles, mapWidth, mapHeight, TileChunkRect(chunkX, chunkY, mapWidth, mapHeight));
+      }
+    }
+  });
+
+  size_t first = 0;
+  for (auto& chunk : chunks) {
+    chunk.first = first;
+    chunk.capacity = chunk.count;
+    first += chunk.count;
+  }
+
+  return chunks;
+}
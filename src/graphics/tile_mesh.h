@@ -0,0 +1,78 @@
+#ifndef KINGDOM_TILE_MESH_H
+#define KINGDOM_TILE_MESH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "tile_sheet.h"
+#include "../core/tile_instance.h"
+
+// Vertex of the Vertices mode tile map, tileVS.glsl scales the position by the tile size and derives the UVs
+// from the tile index and corner
+struct TileVertex {
+  int16_t x, y;   // in tiles
+  uint8_t layer;
+  uint8_t corner; // bit 0 right, bit 1 bottom
+  uint16_t tile;
+};
+static_assert(sizeof(TileVertex) == 8, "TileVertex is uploaded as tightly packed 8 byte records");
+
+// Two triangles per tile
+const int TileVerticesPerTile = 6;
+
+// Tile area [x0, x1) x [y0, y1), in tiles
+struct TileRect {
+  int x0, y0;
+  int x1, y1;
+};
+
+// Tiles are written chunk by chunk (row-major chunks, every layer of a chunk together), so any rectangle of
+// chunks maps to one contiguous buffer range per chunk row
+const int TileChunkSize = 32;
+
+inline int TileChunkCount(int tiles) {
+  return (tiles + TileChunkSize - 1) / TileChunkSize;
+}
+
+inline TileRect TileChunkRect(int chunkX, int chunkY, int mapWidth, int mapHeight) {
+  const int x = chunkX * TileChunkSize, y = chunkY * TileChunkSize;
+  return TileRect{ x, y, x + TileChunkSize < mapWidth ? x + TileChunkSize : mapWidth,
+                   y + TileChunkSize < mapHeight ? y + TileChunkSize : mapHeight };
+}
+
+// Range of one chunk in the buffer, in tiles. count tiles are in use, the rest up to capacity is padding.
+struct TileChunk {
+  size_t first;
+  size_t count;
+  size_t capacity;
+};
+
+/// Buffer ranges of every chunk, row-major, matching the order the Build functions below write tiles in.
+/// Chunks are packed without padding, capacity == count.
+std::vector<TileChunk> BuildTileChunks(const std::vector<int>& tiles, int mapWidth, int mapHeight, int threadCount = 0);
+
+// The Build functions write every tile that isn't -1 inside region and return the number written.
+// region has to start on a chunk boundary, pass the whole map or a single TileChunkRect.
+// Regions spanning several chunk rows are split over threadCount threads (<= 0 uses every hardware thread),
+// the output is the same for any thread count.
+
+/// Writes TileVerticesPerTile vertices per tile
+size_t BuildTileVertices(const std::vector<int>& tiles, int mapWidth, int mapHeight, const TileRect& region,
+                         TileVertex* out, int threadCount = 0);
+
+/// Same as BuildTileVertices, but tiles flagged as animated use frame animIndex of their animation
+size_t BuildAnimatedTileVertices(const std::vector<int>& tiles, const std::vector<uint8_t>& tileFlags,
+                                 const AnimTable& animTable, int animIndex,
+                                 int mapWidth, int mapHeight, const TileRect& region, TileVertex* out,
+                                 int threadCount = 0);
+
+/// Writes one instance per tile
+size_t BuildTileInstances(const std::vector<int>& tiles, int mapWidth, int mapHeight, const TileRect& region,
+                          TileInstance* out, int threadCount = 0);
+
+size_t BuildAnimatedTileInstances(const std::vector<int>& tiles, const std::vector<uint8_t>& tileFlags,
+                                  const AnimTable& animTable, int animIndex,
+                                  int mapWidth, int mapHeight, const TileRect& region, TileInstance* out,
+                                  int threadCount = 0);
+
+#endif //KINGDOM_TILE_MESH_H
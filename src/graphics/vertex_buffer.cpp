@@ -1,5 +1,6 @@
 #include "vertex_buffer.h"
 #include "glad/glad.h"
+#include <algorithm>
 
 VertexBuffer::VertexBuffer() {
   glGenVertexArrays(1, &vao);
@@ -10,12 +11,41 @@ VertexBuffer::~VertexBuffer() {
   glDeleteVertexArrays(1, &vao);
 }
 
-void VertexBuffer::SetBufferData(const float *buffer, const size_t size, GLenum drawType) const {
+void VertexBuffer::SetBufferData(const void *buffer, const size_t size, GLenum drawType) const {
   glBufferData(GL_ARRAY_BUFFER, size, buffer, drawType);
 }
 
-void VertexBuffer::UpdateBufferData(const float *buffer, const size_t offset, const size_t size) const {
-  glBufferSubData(GL_ARRAY_BUFFER, 0, size, buffer);
+void VertexBuffer::UpdateBufferData(const void *buffer, const size_t offset, const size_t size) const {
+  glBufferSubData(GL_ARRAY_BUFFER, offset, size, buffer);
+}
+
+void VertexBuffer::MarkDirty(const size_t offset, const size_t size) {
+  if (size > 0) dirtyRanges.emplace_back(offset, offset + size);
+}
+
+size_t VertexBuffer::UploadDirty(const void *data, const size_t size) {
+  if (dirtyRanges.empty()) return 0;
+
+  // Merge overlapping and touching ranges so every byte goes up once, with one call per merged range
+  std::sort(dirtyRanges.begin(), dirtyRanges.end());
+  size_t uploaded = 0;
+  auto range = dirtyRanges.front();
+  for (size_t i = 1; i <= dirtyRanges.size(); i++) {
+    if (i < dirtyRanges.size() && dirtyRanges[i].first <= range.second) {
+      range.second = std::max(range.second, dirtyRanges[i].second);
+      continue;
+    }
+
+    range.second = std::min(range.second, size);
+    if (range.first < range.second) {
+      UpdateBufferData(static_cast<const uint8_t*>(data) + range.first, range.first, range.second - range.first);
+      uploaded += range.second - range.first;
+    }
+    if (i < dirtyRanges.size()) range = dirtyRanges[i];
+  }
+
+  dirtyRanges.clear();
+  return uploaded;
 }
 
 void VertexBuffer::EnableVertexAttribute(GLint index) const {
@@ -26,6 +56,23 @@ void VertexBuffer::VertexAttribPointer(GLuint index, GLint size, GLenum type, GL
   glVertexAttribPointer(index, size, type, normalized, stride, pointer);
 }
 
+void VertexBuffer::VertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, GLvoid *pointer) const {
+  glVertexAttribIPointer(index, size, type, stride, pointer);
+}
+
+void VertexBuffer::VertexAttribute(GLuint index, GLint size, GLenum type, AttribFormat format, GLsizei stride, size_t offset) const {
+  glEnableVertexAttribArray(index);
+  if (format == AttribFormat::Integer) {
+    glVertexAttribIPointer(index, size, type, stride, (GLvoid*)offset);
+  } else {
+    glVertexAttribPointer(index, size, type, format == AttribFormat::Normalized ? GL_TRUE : GL_FALSE, stride, (GLvoid*)offset);
+  }
+}
+
+void VertexBuffer::VertexAttribDivisor(GLuint index, GLuint divisor) const {
+  glVertexAttribDivisor(index, divisor);
+}
+
 void VertexBuffer::Bind() const {
   glBindVertexArray(vao);
   glBindBuffer(GL_ARRAY_BUFFER, vbo);
@@ -1,21 +1,45 @@
 #ifndef KINGDOM_VERTEX_BUFFER_H
 #define KINGDOM_VERTEX_BUFFER_H
 
+#include <cstddef>
 #include <cstdint>
+#include <utility>
+#include <vector>
 #include "glad/glad.h"
 
+// How the shader sees an attribute's components
+enum struct AttribFormat {
+  Float,      // converted to float as is, e.g. a GL_SHORT of 3 reads as 3.0
+  Normalized, // unsigned types map to [0, 1], signed ones to [-1, 1]
+  Integer     // raw values, read through int/uint inputs
+};
+
 class VertexBuffer {
   uint32_t vao;
   uint32_t vbo;
 
+  // Byte ranges changed since the last UploadDirty, as [begin, end) pairs
+  std::vector<std::pair<size_t, size_t>> dirtyRanges;
+
 public:
   VertexBuffer();
   ~VertexBuffer();
 
-  void SetBufferData(const float *buffer, size_t size, GLenum drawType = GL_STATIC_DRAW) const;
-  void UpdateBufferData(const float *buffer, size_t offet, size_t size) const;
+  void SetBufferData(const void *buffer, size_t size, GLenum drawType = GL_STATIC_DRAW) const;
+  /// Uploads size bytes of buffer to offset bytes into the GPU buffer
+  void UpdateBufferData(const void *buffer, size_t offset, size_t size) const;
+  void MarkDirty(size_t offset, size_t size);
+  /// Uploads the merged dirty ranges out of data, the CPU copy of the buffer holding size bytes, and returns the
+  /// bytes uploaded. Ranges past size are dropped. Expects the buffer to be bound.
+  size_t UploadDirty(const void *data, size_t size);
   void EnableVertexAttribute(GLint index) const;
   void VertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, GLvoid* pointer) const;
+  /// Integer attribute, the shader reads the raw values through an int/uint input
+  void VertexAttribIPointer(GLuint index, GLint size, GLenum type, GLsizei stride, GLvoid* pointer) const;
+  /// Enables the attribute and points it at offset bytes into every stride sized vertex
+  void VertexAttribute(GLuint index, GLint size, GLenum type, AttribFormat format, GLsizei stride, size_t offset) const;
+  /// divisor 1 advances the attribute once per instance instead of once per vertex
+  void VertexAttribDivisor(GLuint index, GLuint divisor) const;
   void Bind() const;
   void Unbind() const;
 };
@@ -1,7 +1,13 @@
+#include <cstdlib>
 #include <iostream>
+#include <string>
+#include <atomic>
+#include <thread>
 #include "glad/glad.h"
 #include "core/game_window.h"
 #include "core/event.h"
+#include "core/frame_scheduler.h"
+#include "core/triple_buffer.h"
 #include "spdlog/spdlog.h"
 #include "entt/entt.hpp"
 #include "gui/imgui_impl_sdl.h"
@@ -14,50 +20,23 @@
 #include "content/file_handler.h"
 #include "game/world_data.h"
 #include "game/world_generator.h"
-#include "game/building_data.h"
+#include "game/world_cache.h"
+#include "game/minimap.h"
+#include "game/simulation.h"
 #include "graphics/tile_map.h"
 #include "graphics/tile_sheet.h"
+#include "graphics/tile_animation.h"
+#include "graphics/building_renderer.h"
+#include "graphics/grid_overlay.h"
 #include "glm/gtc/matrix_transform.hpp"
 #include "toml.hpp"
 
 void generateMinimapTexture(const Texture2D& minimap, const std::vector<uint8_t>& featuremap) {
-  using namespace worldgen;
-  auto imageData = new uint8_t[featuremap.size() * 4];
-
-  size_t i = 0;
-  for (auto feature : featuremap) {
-    if (feature == waterFeature) {
-      imageData[i * 4 + 0] = 0;
-      imageData[i * 4 + 1] = 0;
-      imageData[i * 4 + 2] = 255;
-      imageData[i * 4 + 3] = 255;
-    } else if ((feature & mountainFeature) == mountainFeature) {
-      imageData[i * 4 + 0] = 255;
-      imageData[i * 4 + 1] = 0;
-      imageData[i * 4 + 2] = 0;
-      imageData[i * 4 + 3] = 255;
-    } else if ((feature & landFeature) == landFeature){
-      imageData[i * 4 + 0] = 0;
-      imageData[i * 4 + 1] = 255;
-      imageData[i * 4 + 2] = 0;
-      imageData[i * 4 + 3] = 255;
-    }
-
-    if ((feature & borderFlag) == borderFlag) {
-      imageData[i * 4 + 0] = 255;
-      imageData[i * 4 + 1] = 125;
-      imageData[i * 4 + 2] = 125;
-      imageData[i * 4 + 3] = 255;
-    }
-
-    i++;
-  }
-
-  minimap.SetTextureData(imageData);
-  delete[] imageData;
+  const auto imageData = worldgen::GenerateMinimapPixels(featuremap);
+  minimap.SetTextureData(imageData.data());
 }
 
-int main() {
+int main(int argc, char* argv[]) {
   spdlog::info("Initializing game...");
 
   const int viewport_width = 1280;
@@ -99,17 +78,29 @@ int main() {
   const int mapWidth = 256;
   const int mapHeight = 144;
 
-  const int seed = time(nullptr);
-  //const int seed = 8008135;
+  // A new world every launch, or a fixed one with --seed <n> (e.g. 8008135). Fixed seeds are cached under cache/,
+  // so every launch after the first maps the cached world instead of generating it.
+  uint32_t seed = uint32_t(time(nullptr));
+  bool fixedSeed = false;
+  for (int i = 1; i + 1 < argc; i++) {
+    if (std::string(argv[i]) == "--seed") {
+      seed = uint32_t(std::strtoul(argv[i + 1], nullptr, 10));
+      fixedSeed = true;
+    }
+  }
 
   // Entity/Component
   entt::registry ecsRegister;
   auto worldEntity = ecsRegister.create();
-  ecsRegister.emplace<WorldData>(worldEntity, worldgen::GenerateGameWorld("content/data/tileset.terrain", seed, mapWidth, mapHeight));
+  if (fixedSeed) {
+    ecsRegister.emplace<WorldData>(worldEntity, worldgen::LoadOrGenerateGameWorld("content/data/tileset.terrain", "cache", seed, mapWidth, mapHeight));
+  } else {
+    ecsRegister.emplace<WorldData>(worldEntity, worldgen::GenerateGameWorld("content/data/tileset.terrain", seed, mapWidth, mapHeight));
+  }
 
   auto& worldData = ecsRegister.get<WorldData>(worldEntity);
 
-  TileMap tileMap(mapWidth, mapHeight, worldData.validTileCount);
+  TileMap tileMap(mapWidth, mapHeight);
 
   // minimap texture generation
   auto minimapTexture = Texture2D(mapWidth, mapHeight);
@@ -117,10 +108,10 @@ int main() {
 
   // world rendering setup
   auto tilesheet = TileSheet("content/textures/tileset.png", 16);
-  tileMap.GenerateBuffer(worldData.tileData, tilesheet);
+  tileMap.GenerateBuffer(worldData.tileData);
 
   auto shaderProgram = ShaderProgram(
-      ReadTextFile("content/shaders/texturedVS.glsl"),
+      ReadTextFile(tileMap.VertexShaderPath()),
       ReadTextFile("content/shaders/texturedFS.glsl")
   );
 
@@ -134,6 +125,15 @@ int main() {
   shaderProgram.SetUniform("proj", proj);
   shaderProgram.SetUniform("model", model);
   shaderProgram.SetUniform("view", view);
+  shaderProgram.SetUniform("tileSize", tilesheet.TileSize());
+  shaderProgram.SetUniform("sheetColumns", tilesheet.Width());
+  shaderProgram.SetUniform("sheetRows", tilesheet.Height());
+  shaderProgram.SetUniform("animLookup", 1);
+  shaderProgram.SetUniform("animFrame", 0);
+
+  // Instanced tile maps animate in the vertex shader, only the frame uniform changes afterwards
+  auto tileAnimations = TileAnimationTexture(worldData.animTable, tilesheet.Width() * tilesheet.Height());
+  BuildingRenderer buildingRenderer(tilesheet, tileAnimations);
 
   // Debug GUI
   IMGUI_CHECKVERSION();
@@ -146,87 +146,111 @@ int main() {
 
   // Spritebatch and grid
   SpriteBatch sb(viewport_width, viewport_height);
-  auto gridTexture = Texture2D("content/textures/grid_16x16.png");
+  GridOverlay grid(viewport_width, viewport_height);
 
   bool mouseDown = false;
-  auto cameraPos = glm::vec2(0.f);
-  auto oldPos = glm::vec2(0.f);
-  auto newPos = glm::vec2(0.f);
-
+  auto cameraDrag = glm::vec2(0.f); // summed over the frame, posted once
   auto camera = glm::mat4(1.f);
 
-  // fixed step logic
-  float timer = window.Dt();
-  float animTimer = 0.f;
+  // The fixed step simulation runs on its own thread and hands a RenderSnapshot to this one after every step. From
+  // here on the BuildingData entities belong to the simulation thread, worldData is only read.
+  const float fixed_step = 1.f / 60.f;
+  Simulation simulation(ecsRegister, mapWidth, mapHeight, zoom);
+  TripleBuffer<RenderSnapshot> snapshots;
+  std::atomic<bool> simulating(true);
+
+  std::thread simulationThread([&]() {
+    FrameScheduler scheduler(fixed_step, 8, 1.f / fixed_step);
+    while (simulating.load(std::memory_order_relaxed)) {
+      const int steps = scheduler.BeginFrame();
+      for (int step = 0; step < steps; step++) simulation.Step(scheduler.FixedStep());
+
+      if (steps > 0) {
+        simulation.WriteSnapshot(snapshots.Back());
+        snapshots.Publish();
+      }
+      scheduler.EndFrame();
+    }
+  });
+
+  // Rendering is limited to 144 fps, this scheduler only paces frames
+  FrameScheduler frameScheduler(1.f / 144.f, 1, 144.f);
   int animIndex = 0;
-  const float fixed_step = 0.01667f; // 1/60th of a second
+  uint64_t buildingsVersion = ~uint64_t(0);
 
+  bool running = true;
   SDL_Event sdlEvent;
-  while (true) {
-    // Event Handling
-    if (SDL_PollEvent(&sdlEvent)) {
+  while (running) {
+    frameScheduler.BeginFrame();
+
+    // Event Handling, drain everything that arrived since the last frame
+    while (SDL_PollEvent(&sdlEvent)) {
       ImGui_ImplSDL2_ProcessEvent(&sdlEvent);
 
-      if (sdlEvent.type == SDL_QUIT) break;
-      else if (sdlEvent.type == SDL_WINDOWEVENT && sdlEvent.window.event == SDL_WINDOWEVENT_CLOSE) break;
+      if (sdlEvent.type == SDL_QUIT) running = false;
+      else if (sdlEvent.type == SDL_WINDOWEVENT && sdlEvent.window.event == SDL_WINDOWEVENT_CLOSE) running = false;
       else if (sdlEvent.type == SDL_KEYUP) {
-        gEventHandler.Post(KeyboardEvent(EventType::KeyboardButtonUp, sdlEvent.key.keysym.scancode));
+        gEventHandler.Post(KeyboardEvent{ EventType::KeyboardButtonUp, sdlEvent.key.keysym.scancode });
       } else if (sdlEvent.type == SDL_KEYDOWN) {
-        gEventHandler.Post(KeyboardEvent(EventType::KeyboardButtonDown, sdlEvent.key.keysym.scancode));
+        gEventHandler.Post(KeyboardEvent{ EventType::KeyboardButtonDown, sdlEvent.key.keysym.scancode });
       }
 
       if (sdlEvent.type == SDL_MOUSEBUTTONDOWN && sdlEvent.button.button == SDL_BUTTON_LEFT) {
         mouseDown = true;
-        oldPos = newPos = glm::vec2(sdlEvent.button.x, sdlEvent.button.y);
       } else if (sdlEvent.type == SDL_MOUSEBUTTONUP && sdlEvent.button.button == SDL_BUTTON_LEFT) {
         mouseDown = false;
 
+        // Picked with the camera of the frame the user clicked on
         auto worldPos = glm::inverse(camera) * glm::vec4(sdlEvent.button.x, sdlEvent.button.y, 0.f, 1.f);
-        const int x = int(worldPos.x / tilesheet.TileSize());
-        const int y = int(worldPos.y / tilesheet.TileSize());
-        const int i = x + y * mapWidth;
-
-        auto building = ecsRegister.create();
-        ecsRegister.emplace<BuildingData>(building, 730, x, y);
+        const int x = int(glm::floor(worldPos.x / float(tilesheet.TileSize())));
+        const int y = int(glm::floor(worldPos.y / float(tilesheet.TileSize())));
+        if (!simulation.Post({ SimulationCommand::Type::PlaceBuilding, x, y, glm::vec2(0.f) })) {
+          spdlog::warn("Simulation command queue full, dropped building at ({}, {})", x, y);
+        }
 
         //spdlog::info("tile: ({}, {})", x, y);
+      } else if (sdlEvent.type == SDL_MOUSEMOTION) {
+        gEventHandler.Post(MouseMoveEvent{ sdlEvent.motion.x, sdlEvent.motion.y });
+
+        if (mouseDown) cameraDrag += glm::vec2(sdlEvent.motion.xrel, sdlEvent.motion.yrel);
       }
     }
+    gEventHandler.Flush();
 
-    if (sdlEvent.type == SDL_MOUSEMOTION) {
-      gEventHandler.Post(MouseMoveEvent(sdlEvent.motion.x, sdlEvent.motion.y));
+    // A full command queue keeps the drag for the next frame
+    if (cameraDrag != glm::vec2(0.f) && simulation.Post({ SimulationCommand::Type::MoveCamera, 0, 0, cameraDrag })) {
+      cameraDrag = glm::vec2(0.f);
+    }
 
-      if (mouseDown) {
-        oldPos = newPos;
-        newPos = glm::vec2(sdlEvent.motion.x, sdlEvent.motion.y);
+    // Latest simulation state
+    snapshots.Acquire();
+    const auto& snapshot = snapshots.Front();
 
-        cameraPos += (newPos - oldPos) / zoom;
+    if (snapshot.animIndex != animIndex) {
+      animIndex = snapshot.animIndex;
 
-        camera = glm::scale(glm::mat4(1.f), glm::vec3(zoom));
-        camera = glm::translate(camera, glm::vec3(cameraPos, 0.f));
+      // Update animation frame, vertex tile maps have their UVs baked in and need a rebuild
+      if (tileMap.mode == TileMapMode::Instanced) {
         shaderProgram.Use();
-        shaderProgram.SetUniform("view", camera);
+        shaderProgram.SetUniform("animFrame", animIndex);
+      } else {
+        tileMap.GenerateAnimatedBuffer(worldData.tileData, worldData.tileFlags, worldData.animTable, animIndex);
       }
     }
 
-    // Update logic
-    timer += window.Dt();
-    if (timer >= fixed_step) {
-      timer -= fixed_step;
-
-      // do fixed-step logic here with fixed_step as dt
-      animTimer += fixed_step;
-      if (animTimer >= 0.45f) {
-        animIndex = (animIndex == 3) ? 0 : animIndex + 1;
-        animTimer = 0.f;
-
-        // Update buffer
-        tileMap.GenerateAnimatedBuffer(worldData.tileData, worldData.tileFlags, tilesheet, worldData.animTable, animIndex);
-
-        //spdlog::info("ANIM INDEX: {}", animIndex);
-      }
+    if (snapshot.buildingsVersion != buildingsVersion) {
+      buildingsVersion = snapshot.buildingsVersion;
+      buildingRenderer.Update(snapshot.buildings);
     }
 
+    // Camera between the snapshot's step and the one before, by the time passed since the step
+    const float alpha = glm::clamp(
+        std::chrono::duration<float>(std::chrono::steady_clock::now() - snapshot.time).count() / fixed_step, 0.f, 1.f);
+    camera = glm::scale(glm::mat4(1.f), glm::vec3(zoom));
+    camera = glm::translate(camera, glm::vec3(glm::mix(snapshot.prevCameraPos, snapshot.cameraPos, alpha), 0.f));
+    shaderProgram.Use();
+    shaderProgram.SetUniform("view", camera);
+
     // Gui
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplSDL2_NewFrame(window.Handle());
@@ -244,27 +268,28 @@ int main() {
     glClear(GL_COLOR_BUFFER_BIT);
 
     shaderProgram.Use();
-    tileMap.vertexBuffer.Bind();
     tilesheet.Bind();
-    glDrawArrays(GL_TRIANGLES, 0, tileMap.tileCount * 6);
-    tileMap.vertexBuffer.Unbind();
+    tileAnimations.Bind(1);
+    tileMap.Draw(VisibleTileRect(camera, float(window.Width()), float(window.Height()), tilesheet.TileSize()));
+    buildingRenderer.Draw(proj, camera, animIndex);
 
-    sb.Begin(gridTexture);
-    sb.GetShaderProgram().SetUniform("view", camera);
-    sb.Draw(gridTexture, glm::vec2(0.f), glm::vec2(1.f));
-    sb.GetShaderProgram().SetUniform("view", glm::mat4(1.f));
-    sb.End();
+    grid.Draw(camera, glm::vec2(mapWidth, mapHeight) * float(tilesheet.TileSize()), float(tilesheet.TileSize()));
 
-    sb.Begin(minimapTexture);
+    sb.Begin();
     sb.Draw(minimapTexture, glm::vec2(viewport_width - minimapTexture.Width() - 10.f, 10.f), glm::vec2(1.f));
     sb.End();
 
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
     window.SwapBuffers();
+    frameScheduler.EndFrame();
   }
 
-  gEventHandler.Post(ApplicationCloseEvent());
+  simulating = false;
+  simulationThread.join();
+
+  gEventHandler.Post(ApplicationCloseEvent{});
+  gEventHandler.Flush();
   spdlog::info("Program execution finished.");
   return 0;
 }
@@ -0,0 +1,31 @@
+#ifndef KINGDOM_PARALLEL_H
+#define KINGDOM_PARALLEL_H
+
+#include <algorithm>
+#include "../core/job_system.h"
+
+// Splits [0, rows) into contiguous bands, one per thread, and calls fn(firstRow, lastRow, band) for each.
+// The split only depends on rows and threadCount, so two calls with the same arguments produce the same bands.
+// Bands only ever write to their own rows, so the output does not depend on the thread count.
+// The bands run as jobs on GlobalJobSystem, the calling thread works on them too until all are done.
+template <typename Fn>
+void ForEachRowBand(int rows, int threadCount, const Fn& fn) {
+  const int bands = std::min(rows, ResolveThreadCount(threadCount));
+  if (bands <= 1) {
+    fn(0, rows, 0);
+    return;
+  }
+
+  auto& jobs = GlobalJobSystem();
+  JobCounter counter;
+  for (int band = 1; band < bands; band++) {
+    jobs.Run(counter, [&fn, rows, bands, band]() {
+      fn(rows * band / bands, rows * (band + 1) / bands, band);
+    });
+  }
+
+  fn(0, rows / bands, 0);
+  jobs.Wait(counter);
+}
+
+#endif //KINGDOM_PARALLEL_H
@@ -61,6 +61,24 @@ float Perlin::Noise(float x, float y, float z) const {
   return (res + 1.f) / 2.f;
 }
 
+/// 2D noise, equivalent to Noise(x, y, 0.f) without the z lattice work
+float Perlin::Noise(float x, float y) const {
+  int X = (int)floor(x) & 255;
+  int Y = (int)floor(y) & 255;
+
+  x -= floor(x);
+  y -= floor(y);
+
+  float u = fade(x);
+  float v = fade(y);
+
+  int A = p[X] + Y;
+  int B = p[X + 1] + Y;
+
+  float res = lerp(v, lerp(u, grad(p[p[A]], x, y, 0.f), grad(p[p[B]], x-1, y, 0.f)), lerp(u, grad(p[p[A + 1]], x, y-1, 0.f), grad(p[p[B + 1]], x-1, y-1, 0.f)));
+  return (res + 1.f) / 2.f;
+}
+
 void Perlin::SetNewSeed(uint32_t seed) {
   p.clear();
   p.resize(256);
@@ -72,3 +90,42 @@ void Perlin::SetNewSeed(uint32_t seed) {
 
   p.insert(p.end(), p.begin(), p.end());
 }
+
+Perlin::Slice Perlin::SliceAt(float z) const {
+  return Slice(*this, z);
+}
+
+Perlin::Slice::Slice(const Perlin& perlin, float z)
+  : perm(perlin.p), nearHash(512), farHash(512) {
+  const int Z = (int)floor(z) & 255;
+  this->z = z - floor(z);
+  w = fade(this->z);
+  flat = (this->z == 0.f);
+
+  for (int i = 0; i < 512; i++) {
+    nearHash[i] = perm[perm[i] + Z];
+    farHash[i] = perm[perm[i] + Z + 1];
+  }
+}
+
+float Perlin::Slice::Noise(float x, float y) const {
+  int X = (int)floor(x) & 255;
+  int Y = (int)floor(y) & 255;
+
+  x -= floor(x);
+  y -= floor(y);
+
+  float u = fade(x);
+  float v = fade(y);
+
+  int A = perm[X] + Y;
+  int B = perm[X + 1] + Y;
+
+  float res = lerp(v, lerp(u, grad(nearHash[A], x, y, z), grad(nearHash[B], x-1, y, z)), lerp(u, grad(nearHash[A + 1], x, y-1, z), grad(nearHash[B + 1], x-1, y-1, z)));
+  if (!flat) {
+    float z1 = z - 1;
+    res = lerp(w, res, lerp(v, lerp(u, grad(farHash[A], x, y, z1), grad(farHash[B], x-1, y, z1)), lerp(u, grad(farHash[A + 1], x, y-1, z1), grad(farHash[B + 1], x-1, y-1, z1))));
+  }
+
+  return (res + 1.f) / 2.f;
+}
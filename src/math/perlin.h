@@ -1,6 +1,7 @@
 #ifndef KINGDOM_PERLIN_H
 #define KINGDOM_PERLIN_H
 
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 
@@ -11,11 +12,41 @@ class Perlin {
   static float grad(int hash, float x, float y, float z);
 
 public:
+  // Instruction sets available to the batch Noise path
+  enum class SimdLevel {
+    Scalar,
+    SSE2,
+    AVX2
+  };
+
+  // Noise restricted to a constant z plane. The z lattice hashing is resolved once when the slice is created,
+  // and the far z face is skipped entirely when z lies on the lattice (z = 0, 2, 4...).
+  class Slice {
+    std::vector<int> perm;
+    std::vector<int> nearHash; // nearHash[i] = p[p[i] + Z]
+    std::vector<int> farHash;  // farHash[i]  = p[p[i] + Z + 1]
+    float z, w;
+    bool flat;
+
+  public:
+    Slice(const Perlin& perlin, float z);
+
+    float Noise(float x, float y) const;
+    void Noise(const float* x, const float* y, float* out, size_t count) const;
+  };
+
   Perlin();
   explicit Perlin(uint32_t seed);
 
+  float Noise(float x, float y) const;
   float Noise(float x, float y, float z) const;
+  void Noise(const float* x, const float* y, const float* z, float* out, size_t count) const;
   void SetNewSeed(uint32_t seed);
+  Slice SliceAt(float z) const;
+
+  static SimdLevel SupportedSimdLevel();
+  static SimdLevel ActiveSimdLevel();
+  static void SetSimdLevel(SimdLevel level);
 };
 
 #endif //KINGDOM_PERLIN_H
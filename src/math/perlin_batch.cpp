@@ -0,0 +1,437 @@
+#include "perlin.h"
+#include <atomic>
+
+// Batch evaluation of Perlin::Noise. Every kernel performs the exact same sequence of float operations as the
+// scalar path (no FMA contraction, same operand order), so results are bit-identical regardless of the kernel used.
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define KINGDOM_PERLIN_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(KINGDOM_PERLIN_X86) && (defined(__GNUC__) || defined(__clang__))
+#define KINGDOM_TARGET_SSE2 __attribute__((target("sse2")))
+#define KINGDOM_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define KINGDOM_TARGET_SSE2
+#define KINGDOM_TARGET_AVX2
+#endif
+
+namespace {
+  Perlin::SimdLevel detectSimdLevel() {
+#if defined(KINGDOM_PERLIN_X86)
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+
+    __cpuid(info, 1);
+    const bool sse2 = (info[3] & (1 << 26)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+
+    // AVX2 also requires the OS to save the upper ymm state
+    bool avx2 = false;
+    if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 0x6) == 0x6) {
+      __cpuidex(info, 7, 0);
+      avx2 = (info[1] & (1 << 5)) != 0;
+    }
+#else
+    __builtin_cpu_init();
+    const bool sse2 = __builtin_cpu_supports("sse2");
+    const bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+
+    if (avx2) return Perlin::SimdLevel::AVX2;
+    if (sse2) return Perlin::SimdLevel::SSE2;
+#endif
+    return Perlin::SimdLevel::Scalar;
+  }
+
+  const Perlin::SimdLevel supportedLevel = detectSimdLevel();
+  std::atomic<Perlin::SimdLevel> activeLevel(supportedLevel);
+
+#if defined(KINGDOM_PERLIN_X86)
+  // SSE2 (4 lanes)
+  KINGDOM_TARGET_SSE2
+  inline __m128 selectSSE2(__m128 mask, __m128 a, __m128 b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+  }
+
+  KINGDOM_TARGET_SSE2
+  inline __m128 fadeSSE2(__m128 t) {
+    const __m128 t3 = _mm_mul_ps(_mm_mul_ps(t, t), t);
+    const __m128 inner = _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6.f)), _mm_set1_ps(15.f));
+    return _mm_mul_ps(t3, _mm_add_ps(_mm_mul_ps(t, inner), _mm_set1_ps(10.f)));
+  }
+
+  KINGDOM_TARGET_SSE2
+  inline __m128 lerpSSE2(__m128 t, __m128 a, __m128 b) {
+    return _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a)));
+  }
+
+  KINGDOM_TARGET_SSE2
+  inline __m128 gradSSE2(__m128i hash, __m128 x, __m128 y, __m128 z) {
+    const __m128i h = _mm_and_si128(hash, _mm_set1_epi32(15));
+    const __m128 lt8 = _mm_castsi128_ps(_mm_cmplt_epi32(h, _mm_set1_epi32(8)));
+    const __m128 lt4 = _mm_castsi128_ps(_mm_cmplt_epi32(h, _mm_set1_epi32(4)));
+    const __m128 is12or14 = _mm_castsi128_ps(_mm_or_si128(_mm_cmpeq_epi32(h, _mm_set1_epi32(12)),
+                                                          _mm_cmpeq_epi32(h, _mm_set1_epi32(14))));
+
+    const __m128 u = selectSSE2(lt8, x, y);
+    const __m128 v = selectSSE2(lt4, y, selectSSE2(is12or14, x, z));
+
+    // bit 0 and bit 1 of the hash flip the sign of u and v
+    const __m128 signU = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(1)), 31));
+    const __m128 signV = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(2)), 30));
+    return _mm_add_ps(_mm_xor_ps(u, signU), _mm_xor_ps(v, signV));
+  }
+
+  // floor() for values within int range, returns the floored float and its integer lattice coordinate
+  KINGDOM_TARGET_SSE2
+  inline __m128 floorSSE2(__m128 x, __m128i& lattice) {
+    const __m128i truncated = _mm_cvttps_epi32(x);
+    const __m128 truncatedF = _mm_cvtepi32_ps(truncated);
+    const __m128 roundedUp = _mm_cmpgt_ps(truncatedF, x); // negative non-integers truncate towards zero
+
+    lattice = _mm_add_epi32(truncated, _mm_castps_si128(roundedUp));
+    return _mm_sub_ps(truncatedF, _mm_and_ps(roundedUp, _mm_set1_ps(1.f)));
+  }
+
+  KINGDOM_TARGET_SSE2
+  void noiseSSE2(const int* p, const float* xs, const float* ys, const float* zs, float* out, size_t count) {
+    const __m128 one = _mm_set1_ps(1.f);
+
+    for (size_t i = 0; i + 4 <= count; i += 4) {
+      __m128 x = _mm_loadu_ps(xs + i);
+      __m128 y = _mm_loadu_ps(ys + i);
+      __m128 z = _mm_loadu_ps(zs + i);
+
+      __m128i xi, yi, zi;
+      x = _mm_sub_ps(x, floorSSE2(x, xi));
+      y = _mm_sub_ps(y, floorSSE2(y, yi));
+      z = _mm_sub_ps(z, floorSSE2(z, zi));
+
+      // permutation lookups have no SSE2 gather, resolve the 8 corner hashes per lane
+      alignas(16) int lx[4], ly[4], lz[4];
+      alignas(16) int hashes[8][4];
+      _mm_store_si128((__m128i*)lx, xi);
+      _mm_store_si128((__m128i*)ly, yi);
+      _mm_store_si128((__m128i*)lz, zi);
+
+      for (int l = 0; l < 4; l++) {
+        const int X = lx[l] & 255;
+        const int Y = ly[l] & 255;
+        const int Z = lz[l] & 255;
+
+        const int A = p[X] + Y;
+        const int AA = p[A] + Z;
+        const int AB = p[A + 1] + Z;
+        const int B = p[X + 1] + Y;
+        const int BA = p[B] + Z;
+        const int BB = p[B + 1] + Z;
+
+        hashes[0][l] = p[AA];
+        hashes[1][l] = p[BA];
+        hashes[2][l] = p[AB];
+        hashes[3][l] = p[BB];
+        hashes[4][l] = p[AA + 1];
+        hashes[5][l] = p[BA + 1];
+        hashes[6][l] = p[AB + 1];
+        hashes[7][l] = p[BB + 1];
+      }
+
+      const __m128 u = fadeSSE2(x);
+      const __m128 v = fadeSSE2(y);
+      const __m128 w = fadeSSE2(z);
+
+      const __m128 x1 = _mm_sub_ps(x, one);
+      const __m128 y1 = _mm_sub_ps(y, one);
+      const __m128 z1 = _mm_sub_ps(z, one);
+
+      const __m128 g0 = gradSSE2(_mm_load_si128((const __m128i*)hashes[0]), x, y, z);
+      const __m128 g1 = gradSSE2(_mm_load_si128((const __m128i*)hashes[1]), x1, y, z);
+      const __m128 g2 = gradSSE2(_mm_load_si128((const __m128i*)hashes[2]), x, y1, z);
+      const __m128 g3 = gradSSE2(_mm_load_si128((const __m128i*)hashes[3]), x1, y1, z);
+      const __m128 g4 = gradSSE2(_mm_load_si128((const __m128i*)hashes[4]), x, y, z1);
+      const __m128 g5 = gradSSE2(_mm_load_si128((const __m128i*)hashes[5]), x1, y, z1);
+      const __m128 g6 = gradSSE2(_mm_load_si128((const __m128i*)hashes[6]), x, y1, z1);
+      const __m128 g7 = gradSSE2(_mm_load_si128((const __m128i*)hashes[7]), x1, y1, z1);
+
+      const __m128 res = lerpSSE2(w,
+        lerpSSE2(v, lerpSSE2(u, g0, g1), lerpSSE2(u, g2, g3)),
+        lerpSSE2(v, lerpSSE2(u, g4, g5), lerpSSE2(u, g6, g7)));
+
+      _mm_storeu_ps(out + i, _mm_div_ps(_mm_add_ps(res, one), _mm_set1_ps(2.f)));
+    }
+  }
+
+  template <bool Flat>
+  KINGDOM_TARGET_SSE2
+  void sliceSSE2(const int* perm, const int* nearHash, const int* farHash, float zf, float wf,
+                 const float* xs, const float* ys, float* out, size_t count) {
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 z = _mm_set1_ps(zf);
+    const __m128 z1 = _mm_sub_ps(z, one);
+    const __m128 w = _mm_set1_ps(wf);
+
+    for (size_t i = 0; i + 4 <= count; i += 4) {
+      __m128 x = _mm_loadu_ps(xs + i);
+      __m128 y = _mm_loadu_ps(ys + i);
+
+      __m128i xi, yi;
+      x = _mm_sub_ps(x, floorSSE2(x, xi));
+      y = _mm_sub_ps(y, floorSSE2(y, yi));
+
+      alignas(16) int lx[4], ly[4];
+      alignas(16) int hashes[8][4];
+      _mm_store_si128((__m128i*)lx, xi);
+      _mm_store_si128((__m128i*)ly, yi);
+
+      for (int l = 0; l < 4; l++) {
+        const int A = perm[lx[l] & 255] + (ly[l] & 255);
+        const int B = perm[(lx[l] & 255) + 1] + (ly[l] & 255);
+
+        hashes[0][l] = nearHash[A];
+        hashes[1][l] = nearHash[B];
+        hashes[2][l] = nearHash[A + 1];
+        hashes[3][l] = nearHash[B + 1];
+        if (!Flat) {
+          hashes[4][l] = farHash[A];
+          hashes[5][l] = farHash[B];
+          hashes[6][l] = farHash[A + 1];
+          hashes[7][l] = farHash[B + 1];
+        }
+      }
+
+      const __m128 u = fadeSSE2(x);
+      const __m128 v = fadeSSE2(y);
+      const __m128 x1 = _mm_sub_ps(x, one);
+      const __m128 y1 = _mm_sub_ps(y, one);
+
+      const __m128 g0 = gradSSE2(_mm_load_si128((const __m128i*)hashes[0]), x, y, z);
+      const __m128 g1 = gradSSE2(_mm_load_si128((const __m128i*)hashes[1]), x1, y, z);
+      const __m128 g2 = gradSSE2(_mm_load_si128((const __m128i*)hashes[2]), x, y1, z);
+      const __m128 g3 = gradSSE2(_mm_load_si128((const __m128i*)hashes[3]), x1, y1, z);
+      __m128 res = lerpSSE2(v, lerpSSE2(u, g0, g1), lerpSSE2(u, g2, g3));
+
+      if (!Flat) {
+        const __m128 g4 = gradSSE2(_mm_load_si128((const __m128i*)hashes[4]), x, y, z1);
+        const __m128 g5 = gradSSE2(_mm_load_si128((const __m128i*)hashes[5]), x1, y, z1);
+        const __m128 g6 = gradSSE2(_mm_load_si128((const __m128i*)hashes[6]), x, y1, z1);
+        const __m128 g7 = gradSSE2(_mm_load_si128((const __m128i*)hashes[7]), x1, y1, z1);
+        res = lerpSSE2(w, res, lerpSSE2(v, lerpSSE2(u, g4, g5), lerpSSE2(u, g6, g7)));
+      }
+
+      _mm_storeu_ps(out + i, _mm_div_ps(_mm_add_ps(res, one), _mm_set1_ps(2.f)));
+    }
+  }
+
+  // AVX2 (8 lanes)
+  KINGDOM_TARGET_AVX2
+  inline __m256 fadeAVX2(__m256 t) {
+    const __m256 t3 = _mm256_mul_ps(_mm256_mul_ps(t, t), t);
+    const __m256 inner = _mm256_sub_ps(_mm256_mul_ps(t, _mm256_set1_ps(6.f)), _mm256_set1_ps(15.f));
+    return _mm256_mul_ps(t3, _mm256_add_ps(_mm256_mul_ps(t, inner), _mm256_set1_ps(10.f)));
+  }
+
+  KINGDOM_TARGET_AVX2
+  inline __m256 lerpAVX2(__m256 t, __m256 a, __m256 b) {
+    return _mm256_add_ps(a, _mm256_mul_ps(t, _mm256_sub_ps(b, a)));
+  }
+
+  KINGDOM_TARGET_AVX2
+  inline __m256 gradAVX2(__m256i hash, __m256 x, __m256 y, __m256 z) {
+    const __m256i h = _mm256_and_si256(hash, _mm256_set1_epi32(15));
+    const __m256 lt8 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(8), h));
+    const __m256 lt4 = _mm256_castsi256_ps(_mm256_cmpgt_epi32(_mm256_set1_epi32(4), h));
+    const __m256 is12or14 = _mm256_castsi256_ps(_mm256_or_si256(_mm256_cmpeq_epi32(h, _mm256_set1_epi32(12)),
+                                                                _mm256_cmpeq_epi32(h, _mm256_set1_epi32(14))));
+
+    const __m256 u = _mm256_blendv_ps(y, x, lt8);
+    const __m256 v = _mm256_blendv_ps(_mm256_blendv_ps(z, x, is12or14), y, lt4);
+
+    const __m256 signU = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(1)), 31));
+    const __m256 signV = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(2)), 30));
+    return _mm256_add_ps(_mm256_xor_ps(u, signU), _mm256_xor_ps(v, signV));
+  }
+
+  KINGDOM_TARGET_AVX2
+  inline __m256i permAVX2(const int* p, __m256i index) {
+    return _mm256_i32gather_epi32(p, index, 4);
+  }
+
+  KINGDOM_TARGET_AVX2
+  void noiseAVX2(const int* p, const float* xs, const float* ys, const float* zs, float* out, size_t count) {
+    const __m256 one = _mm256_set1_ps(1.f);
+    const __m256i oneI = _mm256_set1_epi32(1);
+    const __m256i mask = _mm256_set1_epi32(255);
+
+    for (size_t i = 0; i + 8 <= count; i += 8) {
+      __m256 x = _mm256_loadu_ps(xs + i);
+      __m256 y = _mm256_loadu_ps(ys + i);
+      __m256 z = _mm256_loadu_ps(zs + i);
+
+      const __m256 fx = _mm256_floor_ps(x);
+      const __m256 fy = _mm256_floor_ps(y);
+      const __m256 fz = _mm256_floor_ps(z);
+
+      const __m256i X = _mm256_and_si256(_mm256_cvttps_epi32(fx), mask);
+      const __m256i Y = _mm256_and_si256(_mm256_cvttps_epi32(fy), mask);
+      const __m256i Z = _mm256_and_si256(_mm256_cvttps_epi32(fz), mask);
+
+      x = _mm256_sub_ps(x, fx);
+      y = _mm256_sub_ps(y, fy);
+      z = _mm256_sub_ps(z, fz);
+
+      const __m256i A = _mm256_add_epi32(permAVX2(p, X), Y);
+      const __m256i AA = _mm256_add_epi32(permAVX2(p, A), Z);
+      const __m256i AB = _mm256_add_epi32(permAVX2(p, _mm256_add_epi32(A, oneI)), Z);
+      const __m256i B = _mm256_add_epi32(permAVX2(p, _mm256_add_epi32(X, oneI)), Y);
+      const __m256i BA = _mm256_add_epi32(permAVX2(p, B), Z);
+      const __m256i BB = _mm256_add_epi32(permAVX2(p, _mm256_add_epi32(B, oneI)), Z);
+
+      const __m256 u = fadeAVX2(x);
+      const __m256 v = fadeAVX2(y);
+      const __m256 w = fadeAVX2(z);
+
+      const __m256 x1 = _mm256_sub_ps(x, one);
+      const __m256 y1 = _mm256_sub_ps(y, one);
+      const __m256 z1 = _mm256_sub_ps(z, one);
+
+      const __m256 g0 = gradAVX2(permAVX2(p, AA), x, y, z);
+      const __m256 g1 = gradAVX2(permAVX2(p, BA), x1, y, z);
+      const __m256 g2 = gradAVX2(permAVX2(p, AB), x, y1, z);
+      const __m256 g3 = gradAVX2(permAVX2(p, BB), x1, y1, z);
+      const __m256 g4 = gradAVX2(permAVX2(p, _mm256_add_epi32(AA, oneI)), x, y, z1);
+      const __m256 g5 = gradAVX2(permAVX2(p, _mm256_add_epi32(BA, oneI)), x1, y, z1);
+      const __m256 g6 = gradAVX2(permAVX2(p, _mm256_add_epi32(AB, oneI)), x, y1, z1);
+      const __m256 g7 = gradAVX2(permAVX2(p, _mm256_add_epi32(BB, oneI)), x1, y1, z1);
+
+      const __m256 res = lerpAVX2(w,
+        lerpAVX2(v, lerpAVX2(u, g0, g1), lerpAVX2(u, g2, g3)),
+        lerpAVX2(v, lerpAVX2(u, g4, g5), lerpAVX2(u, g6, g7)));
+
+      _mm256_storeu_ps(out + i, _mm256_div_ps(_mm256_add_ps(res, one), _mm256_set1_ps(2.f)));
+    }
+  }
+  template <bool Flat>
+  KINGDOM_TARGET_AVX2
+  void sliceAVX2(const int* perm, const int* nearHash, const int* farHash, float zf, float wf,
+                 const float* xs, const float* ys, float* out, size_t count) {
+    const __m256 one = _mm256_set1_ps(1.f);
+    const __m256i oneI = _mm256_set1_epi32(1);
+    const __m256i mask = _mm256_set1_epi32(255);
+    const __m256 z = _mm256_set1_ps(zf);
+    const __m256 z1 = _mm256_sub_ps(z, one);
+    const __m256 w = _mm256_set1_ps(wf);
+
+    for (size_t i = 0; i + 8 <= count; i += 8) {
+      __m256 x = _mm256_loadu_ps(xs + i);
+      __m256 y = _mm256_loadu_ps(ys + i);
+
+      const __m256 fx = _mm256_floor_ps(x);
+      const __m256 fy = _mm256_floor_ps(y);
+
+      const __m256i X = _mm256_and_si256(_mm256_cvttps_epi32(fx), mask);
+      const __m256i Y = _mm256_and_si256(_mm256_cvttps_epi32(fy), mask);
+
+      x = _mm256_sub_ps(x, fx);
+      y = _mm256_sub_ps(y, fy);
+
+      const __m256i A = _mm256_add_epi32(permAVX2(perm, X), Y);
+      const __m256i B = _mm256_add_epi32(permAVX2(perm, _mm256_add_epi32(X, oneI)), Y);
+      const __m256i A1 = _mm256_add_epi32(A, oneI);
+      const __m256i B1 = _mm256_add_epi32(B, oneI);
+
+      const __m256 u = fadeAVX2(x);
+      const __m256 v = fadeAVX2(y);
+      const __m256 x1 = _mm256_sub_ps(x, one);
+      const __m256 y1 = _mm256_sub_ps(y, one);
+
+      const __m256 g0 = gradAVX2(permAVX2(nearHash, A), x, y, z);
+      const __m256 g1 = gradAVX2(permAVX2(nearHash, B), x1, y, z);
+      const __m256 g2 = gradAVX2(permAVX2(nearHash, A1), x, y1, z);
+      const __m256 g3 = gradAVX2(permAVX2(nearHash, B1), x1, y1, z);
+      __m256 res = lerpAVX2(v, lerpAVX2(u, g0, g1), lerpAVX2(u, g2, g3));
+
+      if (!Flat) {
+        const __m256 g4 = gradAVX2(permAVX2(farHash, A), x, y, z1);
+        const __m256 g5 = gradAVX2(permAVX2(farHash, B), x1, y, z1);
+        const __m256 g6 = gradAVX2(permAVX2(farHash, A1), x, y1, z1);
+        const __m256 g7 = gradAVX2(permAVX2(farHash, B1), x1, y1, z1);
+        res = lerpAVX2(w, res, lerpAVX2(v, lerpAVX2(u, g4, g5), lerpAVX2(u, g6, g7)));
+      }
+
+      _mm256_storeu_ps(out + i, _mm256_div_ps(_mm256_add_ps(res, one), _mm256_set1_ps(2.f)));
+    }
+  }
+#endif
+}
+
+/// Evaluates count samples at once, out[i] == Noise(x[i], y[i], z[i])
+void Perlin::Noise(const float* x, const float* y, const float* z, float* out, size_t count) const {
+  size_t done = 0;
+
+#if defined(KINGDOM_PERLIN_X86)
+  switch (activeLevel.load(std::memory_order_relaxed)) {
+    case SimdLevel::AVX2:
+      noiseAVX2(p.data(), x, y, z, out, count);
+      done = count - count % 8;
+      break;
+    case SimdLevel::SSE2:
+      noiseSSE2(p.data(), x, y, z, out, count);
+      done = count - count % 4;
+      break;
+    case SimdLevel::Scalar:
+      break;
+  }
+#endif
+
+  // scalar fallback and remaining tail
+  for (size_t i = done; i < count; i++) {
+    out[i] = Noise(x[i], y[i], z[i]);
+  }
+}
+
+/// Evaluates count samples on the slice plane, out[i] == Noise(x[i], y[i])
+void Perlin::Slice::Noise(const float* x, const float* y, float* out, size_t count) const {
+  size_t done = 0;
+
+#if defined(KINGDOM_PERLIN_X86)
+  switch (activeLevel.load(std::memory_order_relaxed)) {
+    case SimdLevel::AVX2:
+      if (flat) sliceAVX2<true>(perm.data(), nearHash.data(), farHash.data(), z, w, x, y, out, count);
+      else sliceAVX2<false>(perm.data(), nearHash.data(), farHash.data(), z, w, x, y, out, count);
+      done = count - count % 8;
+      break;
+    case SimdLevel::SSE2:
+      if (flat) sliceSSE2<true>(perm.data(), nearHash.data(), farHash.data(), z, w, x, y, out, count);
+      else sliceSSE2<false>(perm.data(), nearHash.data(), farHash.data(), z, w, x, y, out, count);
+      done = count - count % 4;
+      break;
+    case SimdLevel::Scalar:
+      break;
+  }
+#endif
+
+  for (size_t i = done; i < count; i++) {
+    out[i] = Noise(x[i], y[i]);
+  }
+}
+
+Perlin::SimdLevel Perlin::SupportedSimdLevel() {
+  return supportedLevel;
+}
+Perlin::SimdLevel Perlin::ActiveSimdLevel() {
+  return activeLevel.load(std::memory_order_relaxed);
+}
+
+/// Overrides the batch kernel (for benchmarking), clamped to what the CPU supports
+void Perlin::SetSimdLevel(SimdLevel level) {
+  if (int(level) > int(supportedLevel)) level = supportedLevel;
+  activeLevel.store(level, std::memory_order_relaxed);
+}
@@ -15,4 +15,25 @@ int rng::next_int(int max) {
 }
 int rng::next_int(int min, int max) {
   return rand() % (max - min) + min;
-}
\ No newline at end of file
+}
+
+namespace {
+  uint64_t splitmix64(uint64_t z) {
+    z += 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+  }
+}
+
+uint64_t rng::hash(uint64_t seed, int x, int y, int layer) {
+  const uint64_t position = (uint64_t(uint32_t(x)) << 32) | uint32_t(y);
+  return splitmix64(splitmix64(splitmix64(seed) ^ position) ^ uint32_t(layer));
+}
+int rng::int_at(uint64_t seed, int x, int y, int layer, int max) {
+  // map the upper 32 bits onto [0, max) with a multiply instead of a modulo
+  return int(((hash(seed, x, y, layer) >> 32) * uint64_t(max)) >> 32);
+}
+int rng::int_at(uint64_t seed, int x, int y, int layer, int min, int max) {
+  return int_at(seed, x, y, layer, max - min) + min;
+}
@@ -1,12 +1,20 @@
 #ifndef KINGDOM_RNG_H
 #define KINGDOM_RNG_H
 
+#include <cstdint>
+
 namespace rng {
   void init();
 
   int next_int();
   int next_int(int max);
   int next_int(int min, int max);
+
+  // Stateless counter based generator (SplitMix64 mixing). The same (seed, x, y, layer) key always yields the
+  // same value, so results do not depend on evaluation order and are safe to compute from any thread.
+  uint64_t hash(uint64_t seed, int x, int y, int layer);
+  int int_at(uint64_t seed, int x, int y, int layer, int max);
+  int int_at(uint64_t seed, int x, int y, int layer, int min, int max);
 }
 
 #endif //KINGDOM_RNG_H
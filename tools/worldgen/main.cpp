@@ -0,0 +1,288 @@
+// Headless world generation: generates worlds for a list of seeds without a window or GL context,
+// reports per-stage timings and writes each world (world cache format) plus its minimap to disk.
+#include "game/world_data.h"
+#include "game/world_generator.h"
+#include "game/world_cache.h"
+#include "game/minimap.h"
+#include "core/job_system.h"
+#include "spdlog/spdlog.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace {
+  struct Options {
+    std::vector<uint32_t> seeds;
+    int mapWidth = 256;
+    int mapHeight = 144;
+    std::string terrainPath = "content/data/tileset.terrain";
+    std::string outputDir = "worldgen";
+    int jobs = 0;    // worlds generated at once
+    int threads = 0; // threads per world
+    bool writeMaps = true;
+    bool writeMinimaps = true;
+    bool verify = false; // reload every written world and compare it
+  };
+
+  struct StageTimings {
+    double setup = 0.0;
+    double elevation = 0.0;
+    double features = 0.0;
+    double tiles = 0.0;
+    double output = 0.0;
+
+    double Total() const { return setup + elevation + features + tiles + output; }
+  };
+
+  struct SeedResult {
+    uint32_t seed = 0;
+    size_t validTileCount = 0;
+    StageTimings timings;
+    bool written = true;
+    bool verified = true;
+  };
+
+  void printUsage() {
+    std::printf(
+        "usage: kingdom-worldgen --seeds <list> [options]\n"
+        "  --seeds <list>     comma separated seeds and ranges, e.g. 1,2,10-20 (at most 2^20 seeds)\n"
+        "  --size <w>x<h>     map size in tiles (default 256x144)\n"
+        "  --terrain <path>   terrain file (default content/data/tileset.terrain)\n"
+        "  --out <dir>        output directory (default worldgen)\n"
+        "  --jobs <n>         worlds generated in parallel (default: hardware threads)\n"
+        "  --threads <n>      threads per world (default: hardware threads / jobs)\n"
+        "  --no-maps          skip writing the world files\n"
+        "  --no-minimaps      skip writing the minimap images\n"
+        "  --timings-only     same as --no-maps --no-minimaps\n"
+        "  --verify           reload every world file with LoadWorldCache and compare it against the generated world\n");
+  }
+
+  // More seeds than anyone generates in one run, catches ranges with a typo in them
+  const size_t maxSeeds = size_t(1) << 20;
+
+  // Parses a decimal seed at text, which has to start with a digit and fit into 32 bits
+  bool parseSeed(const char* text, char*& rest, uint32_t& seed) {
+    if (*text < '0' || *text > '9') return false;
+
+    errno = 0;
+    const unsigned long long value = std::strtoull(text, &rest, 10);
+    if (errno == ERANGE || value > UINT32_MAX) return false;
+
+    seed = uint32_t(value);
+    return true;
+  }
+
+  bool parseSeeds(const std::string& list, std::vector<uint32_t>& seeds) {
+    size_t start = 0;
+    while (start <= list.size()) {
+      const size_t end = std::min(list.find(',', start), list.size());
+      const std::string token = list.substr(start, end - start);
+      start = end + 1;
+      if (token.empty()) continue;
+
+      char* rest = nullptr;
+      uint32_t first = 0;
+      if (!parseSeed(token.c_str(), rest, first)) return false;
+      uint32_t last = first;
+      if (*rest == '-' && !parseSeed(rest + 1, rest, last)) return false;
+      if (*rest != '\0' || last < first) return false;
+
+      if (uint64_t(last) - first + 1 > maxSeeds - seeds.size()) {
+        std::fprintf(stderr, "too many seeds, at most %zu per run\n", maxSeeds);
+        return false;
+      }
+      for (uint64_t seed = first; seed <= last; seed++) seeds.push_back(uint32_t(seed));
+    }
+    return !seeds.empty();
+  }
+
+  bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+      const std::string arg = argv[i];
+      const bool hasValue = i + 1 < argc;
+
+      if (arg == "--seeds" && hasValue) {
+        if (!parseSeeds(argv[++i], options.seeds)) return false;
+      } else if (arg == "--size" && hasValue) {
+        if (std::sscanf(argv[++i], "%dx%d", &options.mapWidth, &options.mapHeight) != 2) return false;
+        if (options.mapWidth <= 0 || options.mapHeight <= 0) return false;
+      } else if (arg == "--terrain" && hasValue) {
+        options.terrainPath = argv[++i];
+      } else if (arg == "--out" && hasValue) {
+        options.outputDir = argv[++i];
+      } else if (arg == "--jobs" && hasValue) {
+        options.jobs = std::atoi(argv[++i]);
+      } else if (arg == "--threads" && hasValue) {
+        options.threads = std::atoi(argv[++i]);
+      } else if (arg == "--no-maps") {
+        options.writeMaps = false;
+      } else if (arg == "--no-minimaps") {
+        options.writeMinimaps = false;
+      } else if (arg == "--timings-only") {
+        options.writeMaps = options.writeMinimaps = false;
+      } else if (arg == "--verify") {
+        options.verify = true;
+      } else {
+        return false;
+      }
+    }
+    return !options.seeds.empty() && (options.writeMaps || !options.verify);
+  }
+
+  /// Loads the world file back through the cache path the game uses, true when all arrays match
+  bool verifyWorld(const std::string& path, const WorldData& generated, const Options& options, uint32_t seed,
+                   uint64_t terrainHash) {
+    WorldData loaded(options.terrainPath, options.mapWidth, options.mapHeight, generated.depth);
+    if (!worldgen::LoadWorldCache(path, loaded, seed, terrainHash)) return false;
+
+    return loaded.heightmap == generated.heightmap && loaded.featuremap == generated.featuremap &&
+           loaded.tileData == generated.tileData && loaded.tileFlags == generated.tileFlags &&
+           loaded.validTileCount == generated.validTileCount;
+  }
+
+  /// Binary PPM, the alpha channel of the minimap is dropped
+  bool writeMinimap(const std::string& path, const std::vector<uint8_t>& pixels, int width, int height) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) return false;
+
+    file << "P6\n" << width << " " << height << "\n255\n";
+    std::vector<uint8_t> rgb(size_t(width) * height * 3);
+    for (size_t i = 0; i < size_t(width) * height; i++) {
+      rgb[i * 3 + 0] = pixels[i * 4 + 0];
+      rgb[i * 3 + 1] = pixels[i * 4 + 1];
+      rgb[i * 3 + 2] = pixels[i * 4 + 2];
+    }
+    file.write((const char*)rgb.data(), std::streamsize(rgb.size()));
+
+    return bool(file);
+  }
+
+  SeedResult generateSeed(const Options& options, uint32_t seed, int threadCount, uint64_t terrainHash) {
+    using Clock = std::chrono::steady_clock;
+    auto elapsed = [](Clock::time_point start) {
+      return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    };
+
+    SeedResult result;
+    result.seed = seed;
+
+    // Same stages as GenerateGameWorld, timed individually
+    auto start = Clock::now();
+    WorldData worldData(options.terrainPath, options.mapWidth, options.mapHeight, 5);
+    result.timings.setup = elapsed(start);
+
+    start = Clock::now();
+    worldData.heightmap = worldgen::GenerateElevationLevels(seed, options.mapWidth, options.mapHeight, threadCount);
+    result.timings.elevation = elapsed(start);
+
+    start = Clock::now();
+    worldData.featuremap = worldgen::GenerateFeatureMap(seed, worldData.heightmap, options.mapWidth, options.mapHeight, threadCount);
+    result.timings.features = elapsed(start);
+
+    start = Clock::now();
+    worldgen::CreateTileMap(worldData, seed, threadCount);
+    result.timings.tiles = elapsed(start);
+    result.validTileCount = worldData.validTileCount;
+
+    start = Clock::now();
+    if (options.writeMaps) {
+      const auto path = worldgen::WorldCachePath(options.outputDir, seed, options.mapWidth, options.mapHeight, terrainHash);
+      result.written &= worldgen::SaveWorldCache(path, worldData, seed, terrainHash);
+      if (options.verify && result.written) result.verified = verifyWorld(path, worldData, options, seed, terrainHash);
+    }
+    if (options.writeMinimaps) {
+      const auto path = (std::filesystem::path(options.outputDir) / ("minimap_" + std::to_string(seed) + ".ppm")).string();
+      const auto pixels = worldgen::GenerateMinimapPixels(worldData.featuremap);
+      result.written &= writeMinimap(path, pixels, options.mapWidth, options.mapHeight);
+    }
+    result.timings.output = elapsed(start);
+
+    return result;
+  }
+
+  void printStage(const char* name, const std::vector<SeedResult>& results, double StageTimings::* stage) {
+    double low = results[0].timings.*stage, high = low, sum = 0.0;
+    for (const auto& result : results) {
+      low = std::min(low, result.timings.*stage);
+      high = std::max(high, result.timings.*stage);
+      sum += result.timings.*stage;
+    }
+    std::printf("  %-10s min %9.2f  mean %9.2f  max %9.2f ms\n", name, low, sum / double(results.size()), high);
+  }
+}
+
+int main(int argc, char** argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    printUsage();
+    return 1;
+  }
+
+  if (!std::filesystem::exists(options.terrainPath)) {
+    spdlog::error("Terrain file {} not found", options.terrainPath);
+    return 1;
+  }
+
+  if (options.writeMaps || options.writeMinimaps) {
+    std::error_code error;
+    std::filesystem::create_directories(options.outputDir, error);
+    if (error) {
+      spdlog::error("Failed to create output directory {}: {}", options.outputDir, error.message());
+      return 1;
+    }
+  }
+
+  // Split the hardware threads between worlds generated side by side and the bands inside each world
+  const int hardwareThreads = ResolveThreadCount(0);
+  const int jobs = std::clamp(options.jobs > 0 ? options.jobs : hardwareThreads, 1, int(options.seeds.size()));
+  const int threadCount = options.threads > 0 ? options.threads : std::max(1, hardwareThreads / jobs);
+  const uint64_t terrainHash = worldgen::HashTerrainFile(options.terrainPath);
+
+  spdlog::info("Generating {} worlds of {}x{} ({} jobs, {} threads per world)",
+               options.seeds.size(), options.mapWidth, options.mapHeight, jobs, threadCount);
+
+  std::vector<SeedResult> results(options.seeds.size());
+  std::atomic<size_t> nextSeed(0);
+  auto worker = [&]() {
+    for (size_t i = nextSeed++; i < options.seeds.size(); i = nextSeed++) {
+      results[i] = generateSeed(options, options.seeds[i], threadCount, terrainHash);
+    }
+  };
+
+  // The worlds run as jobs on the shared pool, their bands are nested jobs on the same pool
+  const auto start = std::chrono::steady_clock::now();
+  auto& jobSystem = GlobalJobSystem();
+  JobCounter counter;
+  for (int job = 1; job < jobs; job++) jobSystem.Run(counter, [&worker]() { worker(); });
+  worker();
+  jobSystem.Wait(counter);
+  const double wallTime = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+  bool failed = false;
+  std::printf("%10s %10s %9s %9s %9s %9s %9s %9s\n", "seed", "tiles", "setup", "elevation", "features", "tiles", "output", "total");
+  for (const auto& result : results) {
+    const auto& t = result.timings;
+    std::printf("%10u %10zu %9.2f %9.2f %9.2f %9.2f %9.2f %9.2f%s%s\n", result.seed, result.validTileCount,
+                t.setup, t.elevation, t.features, t.tiles, t.output, t.Total(), result.written ? "" : "  (write failed)",
+                result.verified ? "" : "  (reload differs)");
+    failed |= !result.written || !result.verified;
+  }
+
+  std::printf("stages over %zu worlds:\n", results.size());
+  printStage("setup", results, &StageTimings::setup);
+  printStage("elevation", results, &StageTimings::elevation);
+  printStage("features", results, &StageTimings::features);
+  printStage("tiles", results, &StageTimings::tiles);
+  printStage("output", results, &StageTimings::output);
+  std::printf("wall time %.2f ms (%.2f worlds/s)\n", wallTime, double(results.size()) * 1000.0 / wallTime);
+
+  return failed ? 1 : 0;
+}